@@ -0,0 +1,37 @@
+/*
+ * File: activation.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include "activation.h"
+
+/* Globals */
+static const char *names[ACTIVATION_COUNT] = {
+    "logistic", "fast", "tanh", "relu", "leaky"
+};
+
+const char * activation_name(int activation)
+{
+    if (activation < 0 || activation >= ACTIVATION_COUNT)
+    {
+        return ("unknown");
+    }
+    return (names[activation]);
+}
+
+/* Id of the activation called name, -1 if there is none */
+int activation_lookup(const char *name)
+{
+    int i;
+
+    for (i = 0; i < ACTIVATION_COUNT; i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+        {
+            return (i);
+        }
+    }
+    return (-1);
+}
@@ -0,0 +1,99 @@
+/*
+ * File: activation.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Activation functions, chosen per layer. Every one has an inline scalar
+ * form here for the per neuron path and a vector form in each kernel table
+ * for the batched paths, reached through kernel_bias_activation().
+ *
+ *   ACTIVATION_LOGISTIC  1 / (1 + exp(slope * x)), x clamped to +-45. The
+ *                        vector exp() keeps it within KERNEL_TOLERANCE.
+ *   ACTIVATION_FAST      The same curve with exp() from a cubic in 2^f and
+ *                        the reciprocal refined from the hardware estimate.
+ *                        Absolute error at most ACTIVATION_FAST_ERROR,
+ *                        swept in every table by make check.
+ *   ACTIVATION_TANH      tanh(-slope * x), range -1 to +1. Formed from the
+ *                        vector exp() as 1 - 2 / (1 + exp(-2 * slope * x)),
+ *                        absolute error within KERNEL_TOLERANCE.
+ *   ACTIVATION_RELU      max(x, 0), exact, slope is not used.
+ *   ACTIVATION_LEAKY     max(x, ACTIVATION_LEAK * x), exact.
+ *
+ * Derivatives are taken from the output, as the logistic one always was,
+ * and like it leave out the slope factor.
+ */
+#ifndef ACTIVATION_H
+#define	ACTIVATION_H
+
+#include <stdint.h>
+#include <string.h>
+#include "kernel.h"
+/* Activation ids, stored in model files so never renumber */
+#define ACTIVATION_LOGISTIC 0
+#define ACTIVATION_FAST     1
+#define ACTIVATION_TANH     2
+#define ACTIVATION_RELU     3
+#define ACTIVATION_LEAKY    4
+#define ACTIVATION_COUNT    5
+/* Negative side gradient of the leaky ReLU */
+#define ACTIVATION_LEAK     0.01f
+/* Worst absolute difference of ACTIVATION_FAST from the exact logistic */
+#define ACTIVATION_FAST_ERROR   2.5e-5f
+/* Cubic for 2^f over -0.5 to 0.5, relative error 7.6e-5 */
+#define FAST_EXP_C0         0.99992818f
+#define FAST_EXP_C1         0.69326103f
+#define FAST_EXP_C2         0.24260938f
+#define FAST_EXP_C3         0.05517043f
+#define FAST_EXP_LIMIT      87.0f
+#define FAST_EXP_LOG2E      1.44269504088896341f
+
+/* Prototypes */
+const char * activation_name(int activation);
+int activation_lookup(const char *name);
+
+/* exp(x) to about 1e-4 relative, for ACTIVATION_FAST */
+static inline float activation_fast_exp(float x)
+{
+    float t, f, p, scale;
+    int32_t n;
+    uint32_t bits;
+
+    x = x < -FAST_EXP_LIMIT ? -FAST_EXP_LIMIT : x;
+    x = x > FAST_EXP_LIMIT ? FAST_EXP_LIMIT : x;
+    /* x = (n + f) * ln2, n rounded to nearest so f is within +-0.5 */
+    t = x * FAST_EXP_LOG2E;
+    n = (int32_t) lrintf(t);
+    f = t - (float) n;
+    p = ((FAST_EXP_C3 * f + FAST_EXP_C2) * f + FAST_EXP_C1) * f + FAST_EXP_C0;
+    bits = (uint32_t) (n + 127) << 23;
+    memcpy(&scale, &bits, sizeof (scale));
+    return (p * scale);
+}
+
+static inline float activation_apply(int activation, float slope, float x)
+{
+    switch (activation)
+    {
+    case(ACTIVATION_FAST): return (1 / (1 + activation_fast_exp(slope * x)));
+    case(ACTIVATION_TANH): return (tanhf(-slope * x));
+    case(ACTIVATION_RELU): return (x > 0 ? x : 0);
+    case(ACTIVATION_LEAKY): return (x > 0 ? x : ACTIVATION_LEAK * x);
+    default: return (kernel_sigmoid(slope, x));
+    }
+}
+
+/* Derivative in terms of the activation y */
+static inline float activation_derivative(int activation, float y)
+{
+    switch (activation)
+    {
+    case(ACTIVATION_TANH): return (1 - y * y);
+    case(ACTIVATION_RELU): return (y > 0 ? 1.0f : 0.0f);
+    case(ACTIVATION_LEAKY): return (y > 0 ? 1.0f : ACTIVATION_LEAK);
+    default: return (y * (1 - y));
+    }
+}
+
+#endif	/* ACTIVATION_H */
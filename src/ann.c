@@ -6,7 +6,21 @@
  * Created on: March 16, 2015, 8:08 AM
  * Copyright (C) 2015  Richard G Townsend
  */
+#include <time.h>
+#include <sys/mman.h>
 #include "ann.h"
+#include "kernel.h"
+
+/* One batched pass handed to the worker threads */
+typedef struct
+{
+    Ann *ann;
+    const float *inputs;
+    const float *targets;
+    float *outputs;
+    int rows;
+    int step;           /* Reduction distance */
+} BatchJob;
 
 /* Prototypes */
 static void ann_destruct(Ann *this);
@@ -15,55 +29,170 @@ static void ann_set(Ann *this, int attr, Msg *msg);
 static void feed_forward(Ann *this, Msg *msg);
 static void back_prop(Ann *this, Msg *msg);
 static void calc_output_layer_errors(Ann *this, Msg *msg);
-static void calc_hidden_layer_errors(Ann *this);
-static void calc_input_layer_errors(Ann *this);
-static void train_output_layer(Ann *this);
-static void train_hidden_layer(Ann *this);
-static void train_input_layer(Ann *this);
+static void calc_hidden_layer_errors(Ann *this, int l);
 static void ann_print(Ann *this);
+static void forward_layer(Layer *layer);
+static float back_error(Layer *layer, int i);
+static void train_layer(Ann *this, Layer *layer);
+static int layer_phase(const Ann *this, int l, int input_phase);
+static double layer_flops(const Layer *layer);
+static double ann_flops(const Ann *this, int first);
+static void run_job(Ann *this, PoolJob job, BatchJob *arg);
+static int shard_rows(const BatchJob *job, int id, int count, int *first);
+static void forward_job(void *arg, int id, int count);
+static void train_job(void *arg, int id, int count);
+static void reduce_job(void *arg, int id, int count);
+static Workspace * thread_workspace(const Ann *this);
+static void tls_init(void);
+static void tls_release(void *ws);
+static int ann_workspace_pitch(const Ann *this);
+static void forward_rows(const Ann *this, Workspace *ws, const float *inputs, int rows,
+                         float *outputs);
+static void forward_batch(const Ann *this, Workspace *ws, const float *inputs, int rows,
+                          float *out, int ldout);
+static void forward_batch_layer(const Layer *layer, const float *in, int ldin, int rows,
+                                float *out, int ldout);
+static void predict_layer(const Layer *layer, const float *in, float *out);
+static void backward_batch(Ann *this, Workspace *ws, const float *inputs,
+                           const float *targets, int rows);
+static void backward_batch_layer(const Layer *layer, const float *delta, const float *active_in,
+                                 float *delta_in, int rows, int pitch, int activation);
+static void gradient_batch(const Layer *layer, const float *delta, const float *in, int ldin,
+                           int rows, int pitch, float *grad, float *tgrad);
+static void set_threads(Ann *this, int count);
+static void set_shards(Ann *this);
 static float sqr(float x);
+static Layer * ann_layer(Ann *this, int i);
+static void get_active(Layer *layer, Msg *msg);
 
 /* Globals */
 static int inst_cnt;
+static pthread_once_t tls_once = PTHREAD_ONCE_INIT;
+static pthread_key_t tls_key;   /* Per thread ann_infer workspace */
 
-/* Instantiate a new object */
+/* Instantiate a new object, one hidden layer */
 Ann * ann_construct(int input_count, int hidden_count, int output_count, float LR, float ACL, float SL)
+{
+    int counts[3];
+
+    counts[0] = input_count;
+    counts[1] = hidden_count;
+    counts[2] = output_count;
+    return (ann_construct_layers(3, counts, LR, ACL, SL));
+}
+
+/* Instantiate a network of layer_count layers, counts[0] neurons in the
+ * input layer, counts[layer_count - 1] in the output layer and the hidden
+ * layers in between. At least two layers. */
+Ann * ann_construct_layers(int layer_count, const int *counts, float LR, float ACL, float SL)
 {
     int i;
-    Ann *this = NULL;
-    /* Allocate memory */
-    this = (Ann *) malloc(sizeof (Ann));
-    if (this == NULL)
+    LayerSpec *spec;
+    Ann *this;
+
+    spec = calloc(layer_count, sizeof (LayerSpec));
+    if (spec == NULL)
     {
-        printf("Ann: ::ann_construct Memory allocation failed");
+        printf("Ann: ::ann_construct_layers Memory allocation failed");
         exit(1);
     }
+    /* The input layer sees the raw inputs, the others the layer before */
+    for (i = 0; i < layer_count; i++)
+    {
+        spec[i].count = counts[i];
+        spec[i].inputCnt = counts[i ? i - 1 : 0];
+        spec[i].slope = SL ? SL : -3;
+    }
+    this = ann_construct_spec(layer_count, spec, LR, ACL, SL);
+    free(spec);
+    return (this);
+}
+
+/* Instantiate a network from the shapes in spec. The network, its layers
+ * and the training shards of one thread are carved from a single arena,
+ * so building and destroying a network is one allocation and one free.
+ * NULL if the layers do not chain, each after the first taking as many
+ * inputs as the layer before has neurons. */
+Ann * ann_construct_spec(int layer_count, const LayerSpec *spec, float LR, float ACL, float SL)
+{
+    int i;
+    size_t bytes, room;
+    Arena arena;
+    Ann *this = NULL;
+
+    if (layer_count < 2)
+    {
+        printf("Ann: ::ann_construct_spec %d layers, at least 2 are needed\n", layer_count);
+        return (NULL);
+    }
+    for (i = 0; i < layer_count; i++)
+    {
+        if (spec[i].count < 1 || spec[i].inputCnt < 1
+            || (spec[i].stride != 0 && spec[i].stride < spec[i].inputCnt)
+            || spec[i].activation < 0 || spec[i].activation >= ACTIVATION_COUNT
+            || (i > 0 && spec[i].inputCnt != spec[i - 1].count))
+        {
+            printf("Ann: ::ann_construct_spec Layer %d of %d neurons and %d inputs does not fit\n",
+                   i, spec[i].count, spec[i].inputCnt);
+            return (NULL);
+        }
+    }
+    room = arena_round(sizeof (Workspace *)) + workspace_bytes(spec, layer_count, 32, 1);
+    bytes = arena_round(sizeof (Ann)) + arena_round(layer_count * sizeof (Layer *))
+            + arena_round(layer_count * sizeof (LayerSpec)) + room;
+    for (i = 0; i < layer_count; i++)
+    {
+        bytes += layer_bytes(&spec[i]);
+    }
+    arena_open(&arena, bytes);
+    this = arena_take(&arena, sizeof (Ann));
     /* increment the instance count */
     inst_cnt++;
     /* Set initial values for data members */
-    this->input_count = input_count;
-    this->hidden_count = hidden_count;
-    this->output_count = output_count;
+    this->layer_count = layer_count;
+    this->layers = arena_take(&arena, layer_count * sizeof (Layer *));
+    this->spec = arena_take(&arena, layer_count * sizeof (LayerSpec));
+    /* Init network layers, each neuron is a view onto a row of its layer */
+    for (i = 0; i < layer_count; i++)
+    {
+        this->layers[i] = layer_carve(&arena, &spec[i]);
+        this->spec[i] = spec[i];
+        this->spec[i].stride = this->layers[i]->stride;
+    }
+    /* What is left is kept for the shards */
+    this->room.base = arena_take(&arena, room);
+    this->room.size = room;
+    this->room.used = 0;
+    this->arena = arena;
+    this->scratch.base = NULL;
+    this->input_count = this->layers[0]->inputCnt;
+    this->output_count = this->layers[layer_count - 1]->count;
     this->learning_rate = LR ? LR : 0.02;
     this->accel_rate = ACL ? ACL : 0.02;
     this->slope = SL ? SL : -3;
     this->net_error = 0;
     this->rms_error = 0;
+    this->epoch_error = 0;
+    this->epoch_samples = 0;
     this->dispatcher = (void *) ann_dispatcher; /* Add the dispatcher pointer */
 
-    /* Init network neurons */
-    for (i = 0; i < this->input_count; i++)
+    /* Every layer after the first reads the activations of the one before
+     * where they lie, nothing is copied between layers */
+    for (i = 1; i < layer_count; i++)
     {
-        this->input_layer[i] = NeuronNew(this->input_count, this->slope);
-    }
-    for (i = 0; i < this->hidden_count; i++)
-    {
-        this->hidden_layer[i] = NeuronNew(this->hidden_count, this->slope);
-    }
-    for (i = 0; i < this->output_count; i++)
-    {
-        this->output_layer[i] = NeuronNew(this->output_count, this->slope);
+        this->layers[i]->input = this->layers[i - 1]->active;
     }
+    this->batch_size = 32;
+    optim_init(&this->optim);
+    this->thread_count = 0;
+    this->pool = NULL;
+    this->shards = NULL;
+    this->train_samples = 0;
+    this->train_seconds = 0;
+    this->map = NULL;
+    this->map_size = 0;
+    this->profile = getenv("ANN_PROFILE") != NULL ? ProfileNew() : NULL;
+    set_threads(this, 1);
     /* Return a pointer to the new object */
     return (this);
 }
@@ -72,27 +201,42 @@ Ann * ann_construct(int input_count, int hidden_count, int output_count, float L
 static void ann_destruct(Ann *this)
 {
     int i;
+    Arena arena;
+
     /* Destruct super class/s first */
     //BaseClassDestroy(this->supercls);
     //OtherClassDestroy(this->supercls_1);
-    /* Destroy network neurons */
-    for (i = 0; i < this->input_count; i++)
+    /* Stop the workers and drop their workspaces */
+    set_threads(this, 0);
+    /* Destroy network layers, this releases their neurons */
+    for (i = 0; i < this->layer_count; i++)
     {
-        NeuronDestroy(this->input_layer[i]);
+        LayerDestroy(this->layers[i]);
     }
-    for (i = 0; i < this->hidden_count; i++)
+    /* Mapped layers borrowed their parameters from here */
+    if (this->map != NULL)
     {
-        NeuronDestroy(this->hidden_layer[i]);
+        munmap(this->map, this->map_size);
     }
-    for (i = 0; i < this->output_count; i++)
+    if (this->profile != NULL)
     {
-        NeuronDestroy(this->output_layer[i]);
+        ProfileDestroy(this->profile);
     }
-    free(this);
+    optim_close(&this->optim);
+    /* The arena holds this Ann too, copy it out first */
+    arena = this->arena;
+    arena_close(&arena);
     inst_cnt--;
 }
 
-static void run(Ann *this, Msg *msg)
+/* One sample through the neuron views. msg->inputs holds input_count
+ * values, zero ones replaced with noise, and msg->output receives
+ * output_count. A non zero msg->desired then trains on the sample, every
+ * output aiming at desired, with the momentum rule whatever the optimiser.
+ * Per neuron state is left in the layers, ANN_LAYER reads back the
+ * activations of any of them. ann_train and ann_predict are the fast
+ * paths. */
+void ann_run(Ann *this, Msg *msg)
 {
     int i;
 
@@ -104,168 +248,568 @@ static void run(Ann *this, Msg *msg)
     }
     for (i = 0; i < this->output_count; i++)
     {
-        msg->output[i] = this->output_layer[i]->active;
+        msg->output[i] = this->layers[this->layer_count - 1]->active[i];
     }
 }
 
 static void feed_forward(Ann *this, Msg *msg)
+{
+    int l;
+    uint64_t t0;
+
+    /* Input layer sees the raw inputs, staged once for all its neurons,
+     * each later one reads the layer before */
+    neuron_load_inputs(&this->layers[0]->neurons[0], msg->inputs);
+    for (l = 0; l < this->layer_count; l++)
+    {
+        t0 = profile_start(this->profile);
+        forward_layer(this->layers[l]);
+        profile_stop(this->profile, layer_phase(this, l, PROFILE_FORWARD_INPUT), t0,
+                     layer_flops(this->layers[l]));
+    }
+}
+
+/* Neurons are driven through the direct calls, not the dispatcher */
+static void forward_layer(Layer *layer)
 {
     int i;
 
-    /* Process Input Layer */
-    for (i = 0; i < this->input_count; i++)
+    for (i = 0; i < layer->count; i++)
     {
-        NeuronSet(this->input_layer[i], NEURON_INPUT, msg);
-        NeuronCalcOutput(this->input_layer[i]);
+        neuron_output(&layer->neurons[i]);
     }
-    /* Process Hidden Layer */
-    for (i = 0; i < this->hidden_count; i++)
+}
+
+/* Evaluate rows input vectors at once, inputs is rows x input_count and
+ * outputs rows x output_count. Each layer is one blocked matrix multiply
+ * followed by threshold and activation, rows are shared out across the
+ * threads. Neuron state is left untouched and zero inputs are not replaced
+ * with noise as they are on the Msg path. The scratch belongs to the Ann,
+ * use ann_infer to score from several threads at once. */
+void ann_forward_batch(Ann *this, const float *inputs, int rows, float *outputs)
+{
+    BatchJob job;
+    uint64_t t0 = profile_start(this->profile);
+
+    job.ann = this;
+    job.inputs = inputs;
+    job.targets = NULL;
+    job.outputs = outputs;
+    job.rows = rows;
+    run_job(this, forward_job, &job);
+    profile_stop(this->profile, PROFILE_BATCH_FORWARD, t0, rows * ann_flops(this, 0));
+}
+
+/* Caller owned scratch for ann_infer, one per thread scoring concurrently */
+Workspace * ann_workspace(const Ann *this, int rows)
+{
+    return (WorkspaceNew(this->spec, this->layer_count, rows, 0));
+}
+
+/* Reentrant inference, only the weights, thresholds and slopes of the
+ * network are read and every intermediate lands in ws. Any number of
+ * threads may score on one Ann at once without locks provided each brings
+ * its own workspace, or passes NULL to use one kept per thread. Rows
+ * beyond those the workspace holds are run that many at a time. The
+ * network must not be trained while this runs. */
+void ann_infer(const Ann *this, Workspace *ws, const float *inputs, int rows, float *outputs)
+{
+    uint64_t t0 = profile_start(this->profile);
+
+    if (ws == NULL)
     {
-        NeuronSet(this->hidden_layer[i], NEURON_INPUT, msg);
-        NeuronCalcOutput(this->hidden_layer[i]);
+        ws = thread_workspace(this);
     }
-    /* Process Output Layer */
-    for (i = 0; i < this->output_count; i++)
+    forward_rows(this, ws, inputs, rows, outputs);
+    profile_stop(this->profile, PROFILE_INFER, t0, rows * ann_flops(this, 0));
+}
+
+/* forward_batch over any number of rows, ws->rows at a time */
+static void forward_rows(const Ann *this, Workspace *ws, const float *inputs, int rows,
+                         float *outputs)
+{
+    int r, n;
+
+    for (r = 0; r < rows; r += ws->rows)
     {
-        NeuronSet(this->output_layer[i], NEURON_INPUT, msg);
-        NeuronCalcOutput(this->output_layer[i]);
+        n = rows - r < ws->rows ? rows - r : ws->rows;
+        forward_batch(this, ws, inputs + (size_t) r * this->input_count, n,
+                      outputs + (size_t) r * this->output_count, this->output_count);
     }
 }
 
-static void back_prop(Ann *this, Msg *msg)
+/* Single sample scoring for latency bound callers. One input vector in,
+ * output_count values written to out, both owned by the caller. ws must
+ * come from ann_workspace for this network and is only read and written,
+ * never grown, so the call makes no allocation, takes no lock, prints
+ * nothing and builds no Msg. Each layer is one matrix vector product and
+ * one threshold and activation pass, the cost is fixed by the layer shapes
+ * alone. Like ann_infer zero inputs are used as they are, not replaced with
+ * noise, and one workspace must not be shared by concurrent callers. */
+void ann_predict(const Ann *this, Workspace *ws, const float *input, float *out)
 {
-    /* Calc errors */
-    calc_output_layer_errors(this, msg);
-    calc_hidden_layer_errors(this);
-    calc_input_layer_errors(this);
-    /* Adjust weights */
-    train_output_layer(this);
-    train_hidden_layer(this);
-    train_input_layer(this);
+    int l, last = this->layer_count - 1;
+    const float *in = input;
+    uint64_t t0 = profile_start(this->profile);
+
+    for (l = 0; l < last; l++)
+    {
+        predict_layer(this->layers[l], in, ws->act[l]);
+        in = ws->act[l];
+    }
+    predict_layer(this->layers[last], in, out);
+    profile_stop(this->profile, PROFILE_PREDICT, t0, ann_flops(this, 0));
 }
 
-static void calc_output_layer_errors(Ann *this, Msg *msg)
+static void predict_layer(const Layer *layer, const float *in, float *out)
 {
-    int i;
+    kernel_gemv(layer->count, layer->inputCnt, layer->weights, layer->stride, in, out);
+    kernel_bias_activation(out, 1, layer->count, layer->count, layer->threshold, layer->slope,
+                           layer->activation);
+}
 
-    this->net_error = 0;
-    for (i = 0; i < this->output_count; i++)
+/* Workspace private to the calling thread, freed when the thread exits */
+static Workspace * thread_workspace(const Ann *this)
+{
+    Workspace *ws;
+
+    pthread_once(&tls_once, tls_init);
+    ws = pthread_getspecific(tls_key);
+    /* Rebuilt when a wider or deeper network comes through this thread */
+    if (ws != NULL && (ws->pitch < ann_workspace_pitch(this) || ws->layer_count < this->layer_count))
+    {
+        WorkspaceDestroy(ws);
+        ws = NULL;
+    }
+    if (ws == NULL)
     {
-        NeuronCalcError(this->output_layer[i], msg);
-        this->net_error += sqr(msg->error);
+        ws = ann_workspace(this, ANN_INFER_ROWS);
+        pthread_setspecific(tls_key, ws);
     }
+    return (ws);
+}
+
+static void tls_init(void)
+{
+    pthread_key_create(&tls_key, tls_release);
 }
 
-static void calc_hidden_layer_errors(Ann *this)
+static void tls_release(void *ws)
 {
-    int i, j;
-    Msg msg;
+    WorkspaceDestroy(((Workspace *) ws));
+}
+
+/* Activation pitch a workspace needs for this network */
+static int ann_workspace_pitch(const Ann *this)
+{
+    int i, widest = 1;
 
-    for (i = 0; i < this->hidden_count; i++)
+    for (i = 0; i < this->layer_count; i++)
     {
-        msg.sum = 0;
-        for (j = 0; j < this->output_count; j++)
+        widest = this->layers[i]->count > widest ? this->layers[i]->count : widest;
+    }
+    return ((widest + 15) & ~15);
+}
+
+/* Mini-batch training, inputs is rows x input_count and targets rows x
+ * output_count. Each thread runs the forward and backward pass over its
+ * shard of a batch into private gradients, these are summed with a tree
+ * reduction and the weights updated once per batch using the mean. */
+void ann_train(Ann *this, const float *inputs, const float *targets, int rows)
+{
+    int r, n;
+    BatchJob job;
+    struct timespec t0, t1;
+    uint64_t p0;
+    /* Forward, then errors carried back past every layer but the first and
+     * the gradients of all; reduce and update touch every parameter */
+    double train_flops = 2 * ann_flops(this, 0) + ann_flops(this, 1);
+    double params = ann_flops(this, 0) / 2;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    job.ann = this;
+    job.outputs = NULL;
+    for (r = 0; r < rows; r += this->batch_size)
+    {
+        n = rows - r < this->batch_size ? rows - r : this->batch_size;
+        job.inputs = inputs + (size_t) r * this->input_count;
+        job.targets = targets + (size_t) r * this->output_count;
+        job.rows = n;
+        p0 = profile_start(this->profile);
+        run_job(this, train_job, &job);
+        profile_stop(this->profile, PROFILE_BATCH_TRAIN, p0, n * train_flops);
+        /* Pairwise sums, distance doubling each round, total ends in shard 0 */
+        p0 = profile_start(this->profile);
+        for (job.step = 1; job.step < this->thread_count; job.step *= 2)
         {
-            NeuronGet(this->output_layer[j], NEURON_ERROR, &msg);
-            NeuronGet(this->output_layer[j], NEURON_WEIGHTS, &msg);
-            msg.sum += msg.error * msg.weight; /* Fix me */
+            run_job(this, reduce_job, &job);
         }
-        NeuronCalcError(this->hidden_layer[i], &msg);
-        this->net_error += sqr(msg.sum);
+        profile_stop(this->profile, PROFILE_BATCH_REDUCE, p0, (this->thread_count - 1) * params);
+        this->net_error = this->shards[0]->net_error / n;
+        this->rms_error = sqrt(this->net_error);
+        this->epoch_error += this->shards[0]->net_error;
+        this->epoch_samples += n;
+        p0 = profile_start(this->profile);
+        optim_update(&this->optim, this->layers, this->layer_count, this->shards[0]->grad,
+                     this->shards[0]->tgrad, this->learning_rate, this->accel_rate, n);
+        profile_stop(this->profile, PROFILE_BATCH_UPDATE, p0, optim_flops(&this->optim) * params);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    this->train_samples += rows;
+    this->train_seconds += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+}
+
+/* Mark the end of a training epoch, returns the RMS error over all of it
+ * and starts the count again */
+float ann_epoch(Ann *this)
+{
+    float rms = this->epoch_samples ? sqrt(this->epoch_error / this->epoch_samples) : 0;
+
+    if (this->profile != NULL)
+    {
+        profile_epoch(this->profile, this->train_samples, this->train_seconds, rms);
+    }
+    this->epoch_error = 0;
+    this->epoch_samples = 0;
+    return (rms);
+}
+
+/* Run job on every thread, or inline when single threaded */
+static void run_job(Ann *this, PoolJob job, BatchJob *arg)
+{
+    if (this->pool == NULL)
+    {
+        job(arg, 0, 1);
+    }
+    else
+    {
+        PoolRun(this->pool, job, arg);
+    }
+}
+
+/* First and last row of the shard handled by thread id */
+static int shard_rows(const BatchJob *job, int id, int count, int *first)
+{
+    *first = (int) ((long) job->rows * id / count);
+    return ((int) ((long) job->rows * (id + 1) / count) - *first);
+}
+
+static void forward_job(void *arg, int id, int count)
+{
+    BatchJob *job = arg;
+    Ann *this = job->ann;
+    Workspace *ws = this->shards[id];
+    int first, rows = shard_rows(job, id, count, &first);
+
+    forward_rows(this, ws, job->inputs + (size_t) first * this->input_count, rows,
+                 job->outputs + (size_t) first * this->output_count);
+}
+
+static void train_job(void *arg, int id, int count)
+{
+    BatchJob *job = arg;
+    Ann *this = job->ann;
+    Workspace *ws = this->shards[id];
+    int first, rows = shard_rows(job, id, count, &first);
+    const float *inputs = job->inputs + (size_t) first * this->input_count;
+
+    /* Shards are sized for a batch, see set_shards */
+    forward_batch(this, ws, inputs, rows, ws->act[this->layer_count - 1], ws->pitch);
+    backward_batch(this, ws, inputs, job->targets + (size_t) first * this->output_count, rows);
+}
+
+/* One round of the gradient tree, shard id takes in shard id + step */
+static void reduce_job(void *arg, int id, int count)
+{
+    BatchJob *job = arg;
+    Ann *this = job->ann;
+    Workspace *to, *from;
+    Layer *layer;
+    int i;
+
+    if (id % (2 * job->step) != 0 || id + job->step >= count)
+    {
+        return;
+    }
+    to = this->shards[id];
+    from = this->shards[id + job->step];
+    for (i = 0; i < this->layer_count; i++)
+    {
+        layer = this->layers[i];
+        kernel_ops->axpy(to->grad[i], 1, from->grad[i], layer->count * layer->stride);
+        kernel_ops->axpy(to->tgrad[i], 1, from->tgrad[i], layer->count);
+    }
+    to->net_error += from->net_error;
+}
+
+/* Forward pass keeping every layers activations in the workspace, the
+ * last layer writes to out */
+static void forward_batch(const Ann *this, Workspace *ws, const float *inputs, int rows,
+                          float *out, int ldout)
+{
+    int l, last = this->layer_count - 1;
+    const float *in = inputs;
+    int ldin = this->input_count;
+    uint64_t t0;
+
+    for (l = 0; l <= last; l++)
+    {
+        t0 = profile_start(this->profile);
+        forward_batch_layer(this->layers[l], in, ldin, rows, l < last ? ws->act[l] : out,
+                            l < last ? ws->pitch : ldout);
+        profile_stop(this->profile, layer_phase(this, l, PROFILE_FORWARD_INPUT), t0,
+                     rows * layer_flops(this->layers[l]));
+        in = ws->act[l];
+        ldin = ws->pitch;
     }
 }
 
-static void calc_input_layer_errors(Ann *this)
+static void forward_batch_layer(const Layer *layer, const float *in, int ldin, int rows,
+                                float *out, int ldout)
 {
-    int i, j;
-    Msg msg;
+    kernel_gemm_nt(rows, layer->count, layer->inputCnt, in, ldin,
+                   layer->weights, layer->stride, out, ldout);
+    kernel_bias_activation(out, rows, layer->count, ldout, layer->threshold, layer->slope,
+                           layer->activation);
+}
+
+/* Errors of every layer for the rows of a shard, then its summed gradients */
+static void backward_batch(Ann *this, Workspace *ws, const float *inputs,
+                           const float *targets, int rows)
+{
+    int i, j, l;
+    int last = this->layer_count - 1;
+    int pitch = ws->pitch;
+    float *out, *delta;
+    const float *want;
+    uint64_t t0;
 
-    for (i = 0; i < this->input_count; i++)
+    /* Output layer, (desired - active) * f'(active) */
+    t0 = profile_start(this->profile);
+    ws->net_error = 0;
+    for (i = 0; i < rows; i++)
     {
-        msg.sum = 0;
-        for (j = 0; j < this->hidden_count; j++)
+        out = ws->act[last] + (size_t) i * pitch;
+        delta = ws->delta[last] + (size_t) i * pitch;
+        want = targets + (size_t) i * this->output_count;
+        for (j = 0; j < this->output_count; j++)
         {
-            msg.sum += this->hidden_layer[i]->error * this->hidden_layer[i]->weights[i];
+            delta[j] = want[j] - out[j];
+            ws->net_error += sqr(delta[j]);
         }
-        NeuronCalcError(this->input_layer[i], &msg);
-        this->net_error += sqr(msg.error);
+    }
+    kernel_activation_delta(ws->delta[last], ws->act[last], rows, this->output_count, pitch,
+                            this->layers[last]->activation);
+    profile_stop(this->profile, PROFILE_OUTPUT_ERRORS, t0, 3.0 * rows * this->output_count);
+    /* Every earlier layer, errors carried back through the weights */
+    for (l = last; l > 0; l--)
+    {
+        t0 = profile_start(this->profile);
+        backward_batch_layer(this->layers[l], ws->delta[l], ws->act[l - 1], ws->delta[l - 1],
+                             rows, pitch, this->layers[l - 1]->activation);
+        profile_stop(this->profile, PROFILE_HIDDEN_ERRORS, t0, rows * layer_flops(this->layers[l]));
+    }
+    /* Gradients, errors' * layer inputs */
+    for (l = 0; l <= last; l++)
+    {
+        t0 = profile_start(this->profile);
+        gradient_batch(this->layers[l], ws->delta[l], l > 0 ? ws->act[l - 1] : inputs,
+                       l > 0 ? pitch : this->input_count, rows, pitch, ws->grad[l], ws->tgrad[l]);
+        profile_stop(this->profile, layer_phase(this, l, PROFILE_TRAIN_INPUT), t0,
+                     rows * layer_flops(this->layers[l]));
+    }
+}
+
+/* Error of the layer feeding layer, delta_in = (delta * W) * f'(a), f being
+ * the activation of the feeding layer */
+static void backward_batch_layer(const Layer *layer, const float *delta, const float *active_in,
+                                 float *delta_in, int rows, int pitch, int activation)
+{
+    kernel_gemm_nn(rows, layer->inputCnt, layer->count, delta, pitch,
+                   layer->weights, layer->stride, delta_in, pitch);
+    kernel_activation_delta(delta_in, active_in, rows, layer->inputCnt, pitch, activation);
+}
+
+static void gradient_batch(const Layer *layer, const float *delta, const float *in, int ldin,
+                           int rows, int pitch, float *grad, float *tgrad)
+{
+    kernel_gemm_tn(layer->count, layer->inputCnt, rows, delta, pitch, in, ldin,
+                   grad, layer->stride);
+    kernel_column_sum(delta, rows, layer->count, pitch, tgrad);
+}
+
+/* Resize the worker pool and its workspaces, 0 releases them */
+static void set_threads(Ann *this, int count)
+{
+    if (this->pool != NULL)
+    {
+        PoolDestroy(this->pool);
+        this->pool = NULL;
+    }
+    this->thread_count = count;
+    set_shards(this);
+    if (count > 1)
+    {
+        this->pool = PoolNew(count);
+    }
+}
+
+/* One training workspace per thread, each holding its share of a batch.
+ * They go in the room kept in the network arena when they fit, which they
+ * do for one thread and the default batch, or else in a scratch arena of
+ * their own. Either way they come from one block. */
+static void set_shards(Ann *this)
+{
+    int i, rows;
+    size_t bytes;
+    Arena *arena = &this->room;
+
+    if (this->scratch.base != NULL)
+    {
+        arena_close(&this->scratch);
+    }
+    this->shards = NULL;
+    if (this->thread_count == 0)
+    {
+        return;
+    }
+    rows = (this->batch_size + this->thread_count - 1) / this->thread_count;
+    bytes = arena_round(this->thread_count * sizeof (Workspace *))
+            + this->thread_count * workspace_bytes(this->spec, this->layer_count, rows, 1);
+    if (bytes <= this->room.size)
+    {
+        /* Reused, carving expects zeroed memory */
+        memset(this->room.base, 0, bytes);
+        this->room.used = 0;
+    }
+    else
+    {
+        arena_open(&this->scratch, bytes);
+        arena = &this->scratch;
+    }
+    this->shards = arena_take(arena, this->thread_count * sizeof (Workspace *));
+    for (i = 0; i < this->thread_count; i++)
+    {
+        this->shards[i] = workspace_carve(arena, this->spec, this->layer_count, rows, 1);
+    }
+}
+
+static void back_prop(Ann *this, Msg *msg)
+{
+    int l;
+    uint64_t t0;
+    Layer *layer;
+
+    /* Calc errors, output layer first and back towards the input */
+    t0 = profile_start(this->profile);
+    calc_output_layer_errors(this, msg);
+    profile_stop(this->profile, PROFILE_OUTPUT_ERRORS, t0, 3.0 * this->output_count);
+    for (l = this->layer_count - 2; l >= 0; l--)
+    {
+        t0 = profile_start(this->profile);
+        calc_hidden_layer_errors(this, l);
+        profile_stop(this->profile, PROFILE_HIDDEN_ERRORS, t0, layer_flops(this->layers[l + 1]));
     }
     this->rms_error = sqrt(this->net_error);
+    /* Adjust weights, four operations per weight and threshold */
+    for (l = this->layer_count - 1; l >= 0; l--)
+    {
+        layer = this->layers[l];
+        t0 = profile_start(this->profile);
+        train_layer(this, layer);
+        profile_stop(this->profile, layer_phase(this, l, PROFILE_TRAIN_INPUT), t0,
+                     2 * layer_flops(layer) + 4.0 * layer->count);
+    }
 }
 
-static void train_output_layer(Ann *this)
+static void calc_output_layer_errors(Ann *this, Msg *msg)
 {
-    Msg msg;
     int i;
+    Layer *layer = this->layers[this->layer_count - 1];
 
-    for(i=0;i<this->output_count;i++)
+    this->net_error = 0;
+    for (i = 0; i < layer->count; i++)
     {
-        msg.LR = this->learning_rate;
-        msg.ACL = this->accel_rate;
-        NeuronAdjustWeights(this->output_layer[i], &msg);
-        /* Calc and assign new threshold */
-        NeuronAdjustThreshold(this->output_layer[i], &msg);
+        this->net_error += sqr(neuron_output_error(&layer->neurons[i], msg->desired));
     }
 }
 
-static void train_hidden_layer(Ann *this)
+/* Errors of layer l from the layer above it */
+static void calc_hidden_layer_errors(Ann *this, int l)
 {
-    Msg msg;
     int i;
+    float sum;
+    Layer *layer = this->layers[l];
 
-    for(i=0;i<this->hidden_count;i++)
+    for (i = 0; i < layer->count; i++)
     {
-        msg.LR = this->learning_rate;
-        msg.ACL = this->accel_rate;
-        NeuronAdjustWeights(this->hidden_layer[i], &msg);
-        /* Calc and assign new threshold */
-        NeuronAdjustThreshold(this->hidden_layer[i], &msg);
+        sum = back_error(this->layers[l + 1], i);
+        neuron_hidden_error(&layer->neurons[i], sum);
+        this->net_error += sqr(sum);
     }
 }
 
-static void train_input_layer(Ann *this)
+/* Error fed back to input column i of layer: sum of error * weight */
+static float back_error(Layer *layer, int i)
+{
+    int j;
+    float sum = 0;
+
+    for (j = 0; j < layer->count; j++)
+    {
+        sum += layer->error[j] * LayerRow(layer, weights, j)[i];
+    }
+    return (sum);
+}
+
+static void train_layer(Ann *this, Layer *layer)
 {
-    Msg msg;
     int i;
 
-    for(i=0;i<this->input_count;i++)
+    for(i=0;i<layer->count;i++)
     {
-        msg.LR = this->learning_rate;
-        msg.ACL = this->accel_rate;
-        NeuronAdjustWeights(this->input_layer[i], &msg);
+        neuron_weights_step(&layer->neurons[i], this->learning_rate, this->accel_rate);
         /* Calc and assign new threshold */
-        NeuronAdjustThreshold(this->input_layer[i], &msg);
+        neuron_threshold_step(&layer->neurons[i], this->learning_rate, this->accel_rate);
     }
 }
 
 static void ann_get(Ann *this, int attr, Msg *msg)
 {
-    int i;
-
     switch (attr)
     {
-    case(ANN_INPUT_LAYER):
-    {
-        for (i = 0; i < this->input_count; i++)
-        {
-            NeuronGet(this->input_layer[i], NEURON_ACTIVE, msg);
-        }
-    }
+    case(ANN_INPUT_LAYER): get_active(this->layers[0], msg);
         break;
-    case(ANN_HIDDEN_LAYER):
+    case(ANN_HIDDEN_LAYER): get_active(this->layers[this->layer_count > 2 ? 1 : 0], msg);
+        break;
+    case(ANN_OUTPUT_LAYER): get_active(this->layers[this->layer_count - 1], msg);
+        break;
+    case(ANN_LAYER):
     {
-        for (i = 0; i < this->hidden_count; i++)
+        Layer *layer = ann_layer(this, msg->layer);
+
+        if (layer != NULL)
         {
-            NeuronGet(this->hidden_layer[i], NEURON_ACTIVE, msg);
+            get_active(layer, msg);
         }
     }
         break;
-    case(ANN_OUTPUT_LAYER):
+    case(ANN_BATCH_SIZE): msg->batch_size = this->batch_size;
+        break;
+    case(ANN_THREAD_COUNT): msg->thread_count = this->thread_count;
+        break;
+    case(ANN_PROFILE): msg->profile = this->profile != NULL;
+        break;
+    case(ANN_OPTIMISER):
+        msg->optimiser = this->optim.rule;
+        msg->LR = this->learning_rate;
+        msg->ACL = this->accel_rate;
+        break;
+    case(ANN_ACTIVATION):
     {
-        for (i = 0; i < this->output_count; i++)
-        {
-            NeuronGet(this->output_layer[i], NEURON_ACTIVE, msg);
-        }
+        Layer *layer = ann_layer(this, msg->layer);
+
+        msg->activation = layer != NULL ? layer->activation : -1;
     }
         break;
         /* If this is a derived class and we don't understand the message send
@@ -280,6 +824,49 @@ static void ann_set(Ann *this, int attr, Msg *msg)
 {
     switch (attr)
     {
+    case(ANN_BATCH_SIZE): this->batch_size = msg->batch_size > 0 ? msg->batch_size : 1;
+        /* Shards hold a whole batch between them */
+        if ((this->batch_size + this->thread_count - 1) / this->thread_count > this->shards[0]->rows)
+        {
+            set_shards(this);
+        }
+        break;
+    case(ANN_THREAD_COUNT): set_threads(this, msg->thread_count > 0 ? msg->thread_count : 1);
+        break;
+    case(ANN_PROFILE):
+        /* On starts from zero, off drops the counters */
+        if (msg->profile && this->profile == NULL)
+        {
+            this->profile = ProfileNew();
+        }
+        else if (!msg->profile && this->profile != NULL)
+        {
+            ProfileDestroy(this->profile);
+            this->profile = NULL;
+        }
+        break;
+    case(ANN_OPTIMISER):
+        /* Unknown rules are ignored, negative rates keep the current ones
+         * so an ACL of 0 turns momentum off */
+        if (msg->optimiser >= 0 && msg->optimiser < OPTIM_RULES)
+        {
+            optim_select(&this->optim, msg->optimiser, this->layers, this->layer_count);
+        }
+        this->learning_rate = msg->LR >= 0 ? msg->LR : this->learning_rate;
+        this->accel_rate = msg->ACL >= 0 ? msg->ACL : this->accel_rate;
+        break;
+    case(ANN_ACTIVATION):
+    {
+        Layer *layer = ann_layer(this, msg->layer);
+
+        if (layer == NULL || msg->activation < 0 || msg->activation >= ACTIVATION_COUNT)
+        {
+            printf("Ann: ::ann_set: Bad activation %d for layer %d\n", msg->activation, msg->layer);
+            break;
+        }
+        layer->activation = msg->activation;
+    }
+        break;
     //case(ANN_INPUT_LAYER): this->input_layer = NULL;
         //break;
     //case(ANN_HIDDEN_LAYER): this->hidden_layer = NULL;
@@ -296,8 +883,34 @@ static void ann_print(Ann *this)
 {
     /* If this is a derived class send the message to its supercls first */
     //BaseClassPrint(this, attr, msg);
-    printf("\nInput = %d Hidden = %d output %d\n",
-           this->input_count, this->hidden_count, this->output_count);
+    int i;
+
+    printf("\nInput = %d", this->input_count);
+    for (i = 1; i < this->layer_count - 1; i++)
+    {
+        printf(" Hidden = %d", this->layers[i]->count);
+    }
+    printf(" output %d\n", this->output_count);
+    if (this->train_samples)
+    {
+        printf("Threads = %d Trained = %ld samples/sec = %f Optimiser = %s\n", this->thread_count,
+               this->train_samples, this->train_samples / this->train_seconds,
+               optim_name(this->optim.rule));
+    }
+    if (this->profile != NULL)
+    {
+        for (i = 0; i < PROFILE_PHASES; i++)
+        {
+            ProfileCounter *c = &this->profile->phase[i];
+
+            if (c->calls)
+            {
+                printf("%-16s calls = %llu seconds = %f GFLOPS = %f\n", profile_name(i),
+                       (unsigned long long) c->calls, c->ticks / this->profile->tick_rate,
+                       c->flops / (c->ticks / this->profile->tick_rate) * 1e-9);
+            }
+        }
+    }
 }
 
 void ann_dispatcher(Ann *this, int mthd, int attr, Msg *msg)
@@ -323,7 +936,54 @@ void ann_dispatcher(Ann *this, int mthd, int attr, Msg *msg)
     }
 }
 
+/* Phase of layer l counting from the input one, input_phase is the first
+ * of an input, hidden, output run of phases */
+static int layer_phase(const Ann *this, int l, int input_phase)
+{
+    if (l == 0)
+    {
+        return (input_phase);
+    }
+    return (input_phase + (l == this->layer_count - 1 ? 2 : 1));
+}
+
+/* A multiply and an add per weight of layer */
+static double layer_flops(const Layer *layer)
+{
+    return (2.0 * layer->count * layer->inputCnt);
+}
+
+/* layer_flops summed from layer first to the output */
+static double ann_flops(const Ann *this, int first)
+{
+    int l;
+    double flops = 0;
+
+    for (l = first; l < this->layer_count; l++)
+    {
+        flops += layer_flops(this->layers[l]);
+    }
+    return (flops);
+}
+
 static float sqr(float x)
 {
     return (x * x);
 }
+
+/* Layer i counting from the input layer, NULL when out of range */
+static Layer * ann_layer(Ann *this, int i)
+{
+    if (i < 0 || i >= this->layer_count)
+    {
+        return (NULL);
+    }
+    return (this->layers[i]);
+}
+
+/* Activations of every neuron of layer into msg->output, which holds
+ * layer->count */
+static void get_active(Layer *layer, Msg *msg)
+{
+    memcpy(msg->output, layer->active, layer->count * sizeof (float));
+}
@@ -12,6 +12,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include "neuron.h"
+#include "layer.h"
+#include "workspace.h"
+#include "pool.h"
+#include "profile.h"
+#include "optim.h"
 /* Class Id */
 #define ANN		(('A'+'N'+'N') << 16)
 /* Methods */
@@ -23,7 +28,14 @@
 #define ANN_INPUT_LAYER     ANN + 10
 #define ANN_HIDDEN_LAYER    ANN + 11
 #define ANN_OUTPUT_LAYER    ANN + 12
-#define ANN_MAX             512
+#define ANN_BATCH_SIZE      ANN + 13
+#define ANN_THREAD_COUNT    ANN + 14
+#define ANN_ACTIVATION      ANN + 15    /* msg->activation of layer msg->layer */
+#define ANN_LAYER           ANN + 16    /* Activations of layer msg->layer to msg->output */
+#define ANN_PROFILE         ANN + 17    /* msg->profile, counters on or off */
+#define ANN_OPTIMISER       ANN + 18    /* msg->optimiser, rates from msg->LR and ACL, < 0 keeps */
+/* Other */
+#define ANN_INFER_ROWS      64  /* Rows of the per thread ann_infer workspace */
 
 /* Forward declarations */
 typedef struct _Ann Ann;
@@ -35,30 +47,70 @@ struct _Ann
     int cls; /* Use if this class needs multiple inheritance */
     //BaseClass *supercls; /* Use if this is a derived class */
     int input_count;
-    int hidden_count;
     int output_count;
     float learning_rate;
     float accel_rate;
     float slope;
     float net_error;
     float rms_error;
-    Neuron *input_layer[ANN_MAX];
-    Neuron *hidden_layer[ANN_MAX];
-    Neuron *output_layer[ANN_MAX];
+    /* Squared error and samples trained since the last ann_epoch */
+    double epoch_error;
+    long epoch_samples;
+    /* Layers are sized at construction, fan-in is the previous layer width.
+     * layers[0] is the input layer, layers[layer_count - 1] the output. */
+    int layer_count;
+    Layer **layers;
+    LayerSpec *spec;    /* Shapes of the layers, for sizing workspaces */
+    int batch_size;     /* Samples per weight update in ann_train */
+    Optimiser optim;    /* Update rule of ann_train, see optim.h */
+    /* Data parallel batches, one workspace with private gradients per thread */
+    int thread_count;
+    Pool *pool;         /* NULL when single threaded */
+    Workspace **shards;
+    /* Training throughput, for judging thread scaling */
+    long train_samples;
+    double train_seconds;
+    Profile *profile;   /* NULL unless profiling, see profile.h */
+    /* Model file the layer parameters point into, see model.h */
+    void *map;
+    size_t map_size;
+    /* Everything above is carved from arena, the shards too while they fit
+     * the room kept for them, otherwise from scratch */
+    Arena arena;
+    Arena room;         /* Part of arena set aside for the shards */
+    Arena scratch;      /* Shards that outgrew room, closed when unused */
     void (*dispatcher)(void * this, int mthd, int attr, Msg * msg);
 };
 
 /* Prototypes */
 Ann * ann_construct(int input_count, int hidden_count, int output_count, float LR, float ACL, float SL);
+Ann * ann_construct_layers(int layer_count, const int *counts, float LR, float ACL, float SL);
+Ann * ann_construct_spec(int layer_count, const LayerSpec * spec, float LR, float ACL, float SL);
 void ann_dispatcher(Ann * this, int mthd, int attr, Msg * msg);
+void ann_run(Ann * this, Msg * msg);
+void ann_forward_batch(Ann * this, const float *inputs, int rows, float *outputs);
+Workspace * ann_workspace(const Ann * this, int rows);
+void ann_infer(const Ann * this, Workspace * ws, const float *inputs, int rows, float *outputs);
+void ann_predict(const Ann * this, Workspace * ws, const float *input, float *out);
+void ann_train(Ann * this, const float *inputs, const float *targets, int rows);
+float ann_epoch(Ann * this);
 /* Required for multiple inheritance */
 //void DoSuperMethod(int cls, Ann * this, int mthd, int attr, Msg * msg);
 /* Macros */
 #define AnnNew(input_count, hidden_count, output_count, LR, ACL, SL)   ((ann_construct)(input_count, hidden_count, output_count, LR, ACL, SL))
+#define AnnNewLayers(layer_count, counts, LR, ACL, SL) ((ann_construct_layers)(layer_count, counts, LR, ACL, SL))
+#define AnnNewSpec(layer_count, spec, LR, ACL, SL)  ((ann_construct_spec)(layer_count, spec, LR, ACL, SL))
 #define AnnDestroy(this)            ((this->dispatcher)(this, ANN_DESTROY, 0, NULL))
 #define AnnGet(this, attr, msg)     ((this->dispatcher)(this, ANN_GET, attr, msg))
 #define AnnSet(this, attr, msg)     ((this->dispatcher)(this, ANN_SET, attr, msg))
 #define AnnPrint(this)              ((this->dispatcher)(this, ANN_PRINT, 0, NULL))
+#define AnnRun(this, msg)           ((ann_run)(this, msg))
+#define AnnForwardBatch(this, inputs, rows, outputs)  ((ann_forward_batch)(this, inputs, rows, outputs))
+#define AnnTrain(this, inputs, targets, rows)           ((ann_train)(this, inputs, targets, rows))
+#define AnnEpoch(this)                                  ((ann_epoch)(this))
+#define AnnWorkspace(this, rows)                        ((ann_workspace)(this, rows))
+#define AnnInfer(this, ws, inputs, rows, outputs)       ((ann_infer)(this, ws, inputs, rows, outputs))
+#define AnnPredict(this, ws, input, out)                ((ann_predict)(this, ws, input, out))
 
 
 #endif	/*  __ANN_H__ */
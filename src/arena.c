@@ -0,0 +1,55 @@
+/*
+ * File: arena.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/* One zeroed allocation of size bytes, exits on failure like the
+ * constructors */
+void arena_open(Arena *this, size_t size)
+{
+    void *ptr = NULL;
+
+    size = arena_round(size ? size : 1);
+    if (posix_memalign(&ptr, ARENA_ALIGN, size) != 0)
+    {
+        printf("Arena: ::arena_open Memory allocation failed");
+        exit(1);
+    }
+    memset(ptr, 0, size);
+    this->base = ptr;
+    this->size = size;
+    this->used = 0;
+}
+
+/* Next piece of size bytes. Running out means the owner sized the arena
+ * wrongly, which is a bug, not a condition to recover from. */
+void * arena_take(Arena *this, size_t size)
+{
+    void *ptr;
+
+    size = arena_round(size);
+    if (size > this->size - this->used)
+    {
+        printf("Arena: ::arena_take %zu bytes wanted, %zu left\n", size, this->size - this->used);
+        abort();
+    }
+    ptr = this->base + this->used;
+    this->used += size;
+    return (ptr);
+}
+
+/* Release the block and every piece taken from it */
+void arena_close(Arena *this)
+{
+    free(this->base);
+    this->base = NULL;
+    this->size = 0;
+    this->used = 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * File: arena.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * One aligned block that the pieces of an object are carved from in turn.
+ * The owner works out the total with the _bytes functions of its parts,
+ * opens the arena with a single allocation and closes it with a single
+ * free; the parts themselves are never freed. Every piece starts on an
+ * ARENA_ALIGN boundary and the block starts zeroed, so padding needs no
+ * clearing of its own.
+ */
+#ifndef ARENA_H
+#define	ARENA_H
+
+#include <stddef.h>
+/* Alignment of every piece, one cache line */
+#define ARENA_ALIGN         64
+
+typedef struct
+{
+    char *base;         /* NULL when closed */
+    size_t size;
+    size_t used;
+} Arena;
+
+/* Prototypes */
+void arena_open(Arena * this, size_t size);
+void * arena_take(Arena * this, size_t size);
+void arena_close(Arena * this);
+
+/* Room a piece of size bytes takes in an arena */
+static inline size_t arena_round(size_t size)
+{
+    return ((size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1));
+}
+
+#endif	/* ARENA_H */
@@ -0,0 +1,296 @@
+/*
+ * File: bench.c
+ * Program: ann_bench
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Throughput and latency of the batched network paths, written as JSON so
+ * runs can be kept and compared. Sweeps network width, batch size and
+ * thread count over five phases:
+ *
+ *   predict   one AnnPredict call on a single sample, single threaded
+ *   run       one AnnRun training step on a single sample through the
+ *             direct neuron calls, single threaded
+ *   forward   one AnnForwardBatch call over a batch
+ *   train     one AnnTrain call over a batch, forward, back propagation
+ *             and the weight update
+ *   epoch     AnnTrain over BENCH_EPOCH samples in batches
+ *
+ * Every timed call is recorded and p50 / p99 taken from the sorted times.
+ * FLOPs count a multiply and an add per weight for the forward pass and
+ * three times that for training, which adds the error and gradient passes.
+ *
+ * Usage: ann_bench [-q] [-o file] [-d depth] [-w widths] [-b batches] [-t threads]
+ * with comma separated lists, e.g. -w 64,256 -b 1,32 -t 1,4. Networks have
+ * depth hidden layers, one by default, and every layer the same width.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ann.h"
+#include "kernel.h"
+#include "random.h"
+
+#define BENCH_MAX           16      /* Entries in a sweep list */
+#define BENCH_EPOCH         16384   /* Samples in an epoch run */
+
+/* One sweep point */
+typedef struct
+{
+    const char *phase;
+    int width;
+    int layers;
+    int batch;
+    int threads;
+    int reps;
+    double seconds;     /* Total over all reps */
+    double p50;         /* Seconds per call */
+    double p99;
+    double flops;       /* Per call */
+    long samples;       /* Per call */
+    int neurons;
+} BenchResult;
+
+/* Prototypes */
+static int parse_list(const char *arg, int *list);
+static int compare(const void *a, const void *b);
+static void run(const char *phase, Ann *ann, const float *inputs, const float *targets,
+                float *outputs, int batch, double budget, BenchResult *res);
+static void report(FILE *fp, const BenchResult *res, int first);
+
+int main(int argc, char *argv[])
+{
+    int widths[BENCH_MAX] = {16, 64, 256};
+    int batches[BENCH_MAX] = {1, 32, 256};
+    int threads[BENCH_MAX] = {1, 2, 4};
+    int wc = 3, bc = 3, tc = 3;
+    int w, b, t, opt, i, first = 1, depth = 1;
+    int counts[BENCH_MAX + 2];
+    double budget = 0.25;
+    const char *path = NULL;
+    FILE *fp = stdout;
+    float *inputs, *targets, *outputs;
+    Ann *ann;
+    Msg msg;
+    BenchResult res;
+
+    while ((opt = getopt(argc, argv, "qo:d:w:b:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'q': budget = 0.02;
+            break;
+        case 'd': depth = atoi(optarg);
+            depth = depth < 0 ? 0 : depth > BENCH_MAX ? BENCH_MAX : depth;
+            break;
+        case 'o': path = optarg;
+            break;
+        case 'w': wc = parse_list(optarg, widths);
+            break;
+        case 'b': bc = parse_list(optarg, batches);
+            break;
+        case 't': tc = parse_list(optarg, threads);
+            break;
+        default: fprintf(stderr, "Usage: %s [-q] [-o file] [-d depth] [-w widths] [-b batches] [-t threads]\n",
+                         argv[0]);
+            return (EXIT_FAILURE);
+        }
+    }
+    if (path != NULL && (fp = fopen(path, "w")) == NULL)
+    {
+        fprintf(stderr, "ann_bench: Cannot create %s\n", path);
+        return (EXIT_FAILURE);
+    }
+    random_global_seed(1);
+    fprintf(fp, "{\n  \"kernel\": \"%s\",\n  \"cpus\": %ld,\n  \"results\": [\n",
+            kernel_ops->name, sysconf(_SC_NPROCESSORS_ONLN));
+    for (w = 0; w < wc; w++)
+    {
+        /* Room for the largest batch or an epoch, whichever is bigger */
+        inputs = malloc((size_t) BENCH_EPOCH * widths[w] * sizeof (float));
+        targets = malloc((size_t) BENCH_EPOCH * widths[w] * sizeof (float));
+        outputs = malloc((size_t) BENCH_EPOCH * widths[w] * sizeof (float));
+        if (inputs == NULL || targets == NULL || outputs == NULL)
+        {
+            fprintf(stderr, "ann_bench: Memory allocation failed\n");
+            return (EXIT_FAILURE);
+        }
+        random_fill(random_thread(), inputs, BENCH_EPOCH * widths[w], 0, 1);
+        random_fill(random_thread(), targets, BENCH_EPOCH * widths[w], 0, 1);
+        for (i = 0; i < depth + 2; i++)
+        {
+            counts[i] = widths[w];
+        }
+        ann = AnnNewLayers(depth + 2, counts, 0.05, 0.1, -3);
+        run("predict", ann, inputs, targets, outputs, 1, budget, &res);
+        report(fp, &res, first);
+        first = 0;
+        run("run", ann, inputs, targets, outputs, 1, budget, &res);
+        report(fp, &res, first);
+        for (t = 0; t < tc; t++)
+        {
+            msg.thread_count = threads[t];
+            AnnSet(ann, ANN_THREAD_COUNT, &msg);
+            for (b = 0; b < bc; b++)
+            {
+                if (batches[b] > BENCH_EPOCH)
+                {
+                    continue;
+                }
+                msg.batch_size = batches[b];
+                AnnSet(ann, ANN_BATCH_SIZE, &msg);
+                run("forward", ann, inputs, targets, outputs, batches[b], budget, &res);
+                report(fp, &res, first);
+                run("train", ann, inputs, targets, outputs, batches[b], budget, &res);
+                report(fp, &res, first);
+            }
+            /* Epochs at the default batch size */
+            msg.batch_size = 32;
+            AnnSet(ann, ANN_BATCH_SIZE, &msg);
+            run("epoch", ann, inputs, targets, outputs, BENCH_EPOCH, budget, &res);
+            report(fp, &res, first);
+        }
+        AnnDestroy(ann);
+        free(inputs);
+        free(targets);
+        free(outputs);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+    return (EXIT_SUCCESS);
+}
+
+/* Time phase over rows samples until budget seconds have passed */
+static void run(const char *phase, Ann *ann, const float *inputs, const float *targets,
+                float *outputs, int rows, double budget, BenchResult *res)
+{
+    int cap = 1024, reps = 0;
+    double *times, start, t0, macs;
+    int l;
+    Workspace *ws = NULL;
+    Msg msg;
+
+    times = malloc(cap * sizeof (double));
+    if (times == NULL)
+    {
+        fprintf(stderr, "ann_bench: Memory allocation failed\n");
+        exit(1);
+    }
+    /* One untimed call warms caches and the thread pool */
+    AnnForwardBatch(ann, inputs, rows, outputs);
+    if (strcmp(phase, "predict") == 0)
+    {
+        ws = AnnWorkspace(ann, 1);
+    }
+    /* Every output of the Msg path aims at the one desired value */
+    msg.inputs = (float *) inputs;
+    msg.output = outputs;
+    msg.desired = targets[0];
+    start = profile_seconds();
+    do
+    {
+        t0 = profile_seconds();
+        if (ws != NULL)
+        {
+            AnnPredict(ann, ws, inputs, outputs);
+        }
+        else if (strcmp(phase, "forward") == 0)
+        {
+            AnnForwardBatch(ann, inputs, rows, outputs);
+        }
+        else if (strcmp(phase, "run") == 0)
+        {
+            AnnRun(ann, &msg);
+        }
+        else
+        {
+            AnnTrain(ann, inputs, targets, rows);
+        }
+        if (reps == cap)
+        {
+            cap *= 2;
+            times = realloc(times, cap * sizeof (double));
+            if (times == NULL)
+            {
+                fprintf(stderr, "ann_bench: Memory allocation failed\n");
+                exit(1);
+            }
+        }
+        times[reps++] = profile_seconds() - t0;
+    } while (profile_seconds() - start < budget || reps < 3);
+
+    res->phase = phase;
+    res->width = ann->input_count;
+    res->batch = strcmp(phase, "epoch") == 0 ? ann->batch_size : rows;
+    res->threads = ann->thread_count;
+    res->reps = reps;
+    res->samples = rows;
+    res->layers = ann->layer_count;
+    res->neurons = 0;
+    macs = 0;
+    for (l = 0; l < ann->layer_count; l++)
+    {
+        res->neurons += ann->layers[l]->count;
+        macs += (double) ann->layers[l]->count * ann->layers[l]->inputCnt;
+    }
+    res->seconds = 0;
+    for (reps = 0; reps < res->reps; reps++)
+    {
+        res->seconds += times[reps];
+    }
+    qsort(times, res->reps, sizeof (double), compare);
+    res->p50 = times[res->reps / 2];
+    res->p99 = times[(res->reps * 99) / 100];
+    res->flops = 2 * macs * rows * (strcmp(phase, "forward") == 0 || ws != NULL ? 1 : 3);
+    free(times);
+    if (ws != NULL)
+    {
+        WorkspaceDestroy(ws);
+    }
+}
+
+static void report(FILE *fp, const BenchResult *res, int first)
+{
+    double per_call = res->seconds / res->reps;
+
+    fprintf(fp, "%s    {\"phase\": \"%s\", \"width\": %d, \"layers\": %d, \"batch\": %d, \"threads\": %d, "
+            "\"reps\": %d, \"samples_per_sec\": %.1f, \"gflops\": %.3f, "
+            "\"ns_per_neuron\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f}",
+            first ? "" : ",\n", res->phase, res->width, res->layers, res->batch, res->threads, res->reps,
+            res->samples / per_call, res->flops / per_call * 1e-9,
+            per_call * 1e9 / ((double) res->samples * res->neurons),
+            res->p50 * 1e6, res->p99 * 1e6);
+    fflush(fp);
+}
+
+/* Comma separated list of positive ints, returns the count */
+static int parse_list(const char *arg, int *list)
+{
+    int n = 0;
+    char *end;
+
+    while (n < BENCH_MAX && *arg)
+    {
+        list[n] = strtol(arg, &end, 10);
+        if (end == arg || list[n] <= 0)
+        {
+            fprintf(stderr, "ann_bench: Bad list %s\n", arg);
+            exit(1);
+        }
+        n++;
+        arg = *end == ',' ? end + 1 : end;
+    }
+    return (n);
+}
+
+static int compare(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return ((x > y) - (x < y));
+}
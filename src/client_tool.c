@@ -0,0 +1,247 @@
+/*
+ * File: client_tool.c
+ * Program: ann_client
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Load generator for ann -S. Opens clients connections at once, each
+ * sending requests samples of random inputs one at a time and waiting for
+ * each reply, then reports the requests per second over all of them and
+ * the p50, p99 and largest round trip. With -l model every reply is checked
+ * against the outputs of the same network run here through AnnPredict and
+ * the largest difference is reported. -s prints the counters and
+ * histograms of the server afterwards.
+ *
+ * Usage: ann_client [-n requests] [-c clients] [-l model] [-s] address
+ * address as given to ann -S, unix:path or [host:]port.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "ann.h"
+#include "model.h"
+#include "random.h"
+#include "server.h"
+
+/* One connection and its share of the results */
+typedef struct
+{
+    const char *address;
+    int id;
+    int requests;
+    const Ann *ann;     /* Reference network, NULL for none */
+    double *seconds;    /* requests round trips */
+    float max_diff;
+    int failed;
+} ClientJob;
+
+/* Prototypes */
+static void * client(void *arg);
+static int stats(const char *address);
+static int compare(const void *a, const void *b);
+
+int main(int argc, char *argv[])
+{
+    int opt, i, requests = 1000, clients = 1, show = 0, failed = 0;
+    long total;
+    float max_diff = 0;
+    const char *model = NULL;
+    double t0, elapsed, *seconds;
+    Ann *ann = NULL;
+    pthread_t *threads;
+    ClientJob *jobs;
+
+    while ((opt = getopt(argc, argv, "n:c:l:s")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': requests = atoi(optarg);
+            break;
+        case 'c': clients = atoi(optarg);
+            break;
+        case 'l': model = optarg;
+            break;
+        case 's': show = 1;
+            break;
+        default: fprintf(stderr, "Usage: %s [-n requests] [-c clients] [-l model] [-s] address\n", argv[0]);
+            return (EXIT_FAILURE);
+        }
+    }
+    if (optind != argc - 1 || requests < 1 || clients < 1)
+    {
+        fprintf(stderr, "Usage: %s [-n requests] [-c clients] [-l model] [-s] address\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+    if (model != NULL && (ann = AnnLoad(model)) == NULL)
+    {
+        return (EXIT_FAILURE);
+    }
+    total = (long) requests * clients;
+    seconds = malloc(total * sizeof (double));
+    threads = malloc(clients * sizeof (pthread_t));
+    jobs = malloc(clients * sizeof (ClientJob));
+    if (seconds == NULL || threads == NULL || jobs == NULL)
+    {
+        fprintf(stderr, "ann_client: Memory allocation failed\n");
+        exit(1);
+    }
+    t0 = profile_seconds();
+    for (i = 0; i < clients; i++)
+    {
+        jobs[i].address = argv[optind];
+        jobs[i].id = i;
+        jobs[i].requests = requests;
+        jobs[i].ann = ann;
+        jobs[i].seconds = seconds + (size_t) i * requests;
+        jobs[i].max_diff = 0;
+        jobs[i].failed = 0;
+        if (pthread_create(&threads[i], NULL, client, &jobs[i]) != 0)
+        {
+            fprintf(stderr, "ann_client: Thread creation failed\n");
+            exit(1);
+        }
+    }
+    for (i = 0; i < clients; i++)
+    {
+        pthread_join(threads[i], NULL);
+        failed |= jobs[i].failed;
+        max_diff = jobs[i].max_diff > max_diff ? jobs[i].max_diff : max_diff;
+    }
+    elapsed = profile_seconds() - t0;
+    if (!failed)
+    {
+        qsort(seconds, total, sizeof (double), compare);
+        printf("%ld requests over %d connections in %.3f s, %.1f requests/sec\n",
+               total, clients, elapsed, total / elapsed);
+        printf("Round trip p50 %.1f us, p99 %.1f us, max %.1f us\n", seconds[total / 2] * 1e6,
+               seconds[(long) (total * 0.99)] * 1e6, seconds[total - 1] * 1e6);
+        if (ann != NULL)
+        {
+            printf("Largest difference from %s %g\n", model, max_diff);
+        }
+    }
+    if (show && !failed)
+    {
+        failed = !stats(argv[optind]);
+    }
+    free(seconds);
+    free(threads);
+    free(jobs);
+    if (ann != NULL)
+    {
+        AnnDestroy(ann);
+    }
+    return (failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static void * client(void *arg)
+{
+    ClientJob *job = arg;
+    int fd, r, j;
+    int32_t kind = SERVER_INFER, shape[2];
+    float *input, *output, *want = NULL, diff;
+    double t0;
+    Random rng;
+    Workspace *ws = NULL;
+
+    /* server_connect says why it failed */
+    fd = server_connect(job->address);
+    if (fd < 0)
+    {
+        job->failed = 1;
+        return (NULL);
+    }
+    if (!server_receive(fd, shape, sizeof (shape)))
+    {
+        fprintf(stderr, "ann_client: No reply from %s\n", job->address);
+        job->failed = 1;
+        close(fd);
+        return (NULL);
+    }
+    if (job->ann != NULL && (shape[0] != job->ann->input_count || shape[1] != job->ann->output_count))
+    {
+        fprintf(stderr, "ann_client: Server network is %d x %d, the model %d x %d\n", shape[0],
+                shape[1], job->ann->input_count, job->ann->output_count);
+        job->failed = 1;
+        close(fd);
+        return (NULL);
+    }
+    input = malloc(shape[0] * sizeof (float));
+    output = malloc(shape[1] * sizeof (float));
+    if (input == NULL || output == NULL)
+    {
+        fprintf(stderr, "ann_client: Memory allocation failed\n");
+        exit(1);
+    }
+    if (job->ann != NULL)
+    {
+        want = malloc(shape[1] * sizeof (float));
+        ws = AnnWorkspace(job->ann, 1);
+    }
+    random_seed(&rng, RANDOM_DEFAULT_SEED, job->id);
+    for (r = 0; r < job->requests; r++)
+    {
+        random_fill(&rng, input, shape[0], 0, 1);
+        t0 = profile_seconds();
+        if (!server_send(fd, &kind, sizeof (kind)) || !server_send(fd, input, shape[0] * sizeof (float))
+            || !server_receive(fd, output, shape[1] * sizeof (float)))
+        {
+            fprintf(stderr, "ann_client: Connection to %s lost\n", job->address);
+            job->failed = 1;
+            break;
+        }
+        job->seconds[r] = profile_seconds() - t0;
+        if (ws != NULL)
+        {
+            AnnPredict(job->ann, ws, input, want);
+            for (j = 0; j < shape[1]; j++)
+            {
+                diff = fabsf(output[j] - want[j]);
+                job->max_diff = diff > job->max_diff ? diff : job->max_diff;
+            }
+        }
+    }
+    if (ws != NULL)
+    {
+        WorkspaceDestroy(ws);
+        free(want);
+    }
+    free(input);
+    free(output);
+    close(fd);
+    return (NULL);
+}
+
+/* Print the JSON counters of the server, 1 when fetched */
+static int stats(const char *address)
+{
+    int fd, ok;
+    int32_t kind = SERVER_STATS, shape[2], length = 0;
+    char *text = NULL;
+
+    fd = server_connect(address);
+    if (fd < 0)
+    {
+        return (0);
+    }
+    ok = server_receive(fd, shape, sizeof (shape)) && server_send(fd, &kind, sizeof (kind))
+            && server_receive(fd, &length, sizeof (length)) && length >= 0
+            && (text = malloc(length + 1)) != NULL && server_receive(fd, text, length);
+    if (ok)
+    {
+        text[length] = '\0';
+        fputs(text, stdout);
+    }
+    free(text);
+    close(fd);
+    return (ok);
+}
+
+static int compare(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return ((x > y) - (x < y));
+}
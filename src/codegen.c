@@ -0,0 +1,265 @@
+/*
+ * File: codegen.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include <ctype.h>
+#include "codegen.h"
+
+/* Prototypes */
+static void codegen_helpers(const Ann *ann, const char *name, FILE *fp);
+static void codegen_arrays(const Layer *layer, const char *name, int l, FILE *fp);
+static void codegen_layer(const Layer *layer, const char *name, int l, int last, FILE *fp);
+static void codegen_activation(const Layer *layer, const char *name, FILE *fp);
+static const char * codegen_float(float x, char *buf);
+
+/* Globals */
+/* C and C++ keywords and the C++ alternative tokens, none of which can
+ * name a function. Those starting _ and a capital are reserved anyway. */
+static const char *reserved[] = {
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break",
+    "case", "catch", "char", "char8_t", "char16_t", "char32_t", "class", "co_await", "co_return",
+    "co_yield", "compl", "concept", "const", "const_cast", "consteval", "constexpr", "constinit",
+    "continue", "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum",
+    "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if", "inline",
+    "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr",
+    "operator", "or", "or_eq", "private", "protected", "public", "register", "reinterpret_cast",
+    "requires", "restrict", "return", "short", "signed", "sizeof", "static", "static_assert",
+    "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true", "try",
+    "typedef", "typeid", "typename", "typeof", "typeof_unqual", "union", "unsigned", "using",
+    "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"
+};
+static int codegen_unrolled(const Layer *layer);
+
+/* Write the source of a function name scoring ann to fp, 0 when written */
+int codegen_write(const Ann *ann, const char *name, FILE *fp)
+{
+    int l, i, last = ann->layer_count - 1;
+
+    if (!codegen_name(name))
+    {
+        printf("Codegen: %s is not a C identifier or is reserved\n", name);
+        return (-1);
+    }
+    fprintf(fp, "/*\n * Generated by ann_codegen, do not edit.\n *\n * %d inputs, layers of", ann->input_count);
+    for (l = 0; l < ann->layer_count; l++)
+    {
+        fprintf(fp, "%s %d %s", l == 0 ? "" : ",", ann->layers[l]->count,
+                activation_name(ann->layers[l]->activation));
+    }
+    fprintf(fp, ".\n *\n *   void %s(const float *in, float *out);\n"
+            " *   void %s_batch(const float *in, long rows, float *out);\n */\n", name, name);
+    fprintf(fp, "#include <math.h>\n#include <stdint.h>\n#include <string.h>\n\n");
+    fprintf(fp, "#define ");
+    for (i = 0; name[i] != '\0'; i++)
+    {
+        fputc(toupper((unsigned char) name[i]), fp);
+    }
+    fprintf(fp, "_INPUTS %d\n#define ", ann->input_count);
+    for (i = 0; name[i] != '\0'; i++)
+    {
+        fputc(toupper((unsigned char) name[i]), fp);
+    }
+    fprintf(fp, "_OUTPUTS %d\n\n", ann->output_count);
+    codegen_helpers(ann, name, fp);
+    for (l = 0; l < ann->layer_count; l++)
+    {
+        codegen_arrays(ann->layers[l], name, l, fp);
+    }
+    fprintf(fp, "void %s(const float *in, float *out)\n{\n", name);
+    for (l = 0; l < ann->layer_count; l++)
+    {
+        codegen_layer(ann->layers[l], name, l, l == last, fp);
+    }
+    fprintf(fp, "}\n\n");
+    fprintf(fp, "void %s_batch(const float *in, long rows, float *out)\n{\n", name);
+    fprintf(fp, "    long r;\n\n    for (r = 0; r < rows; r++)\n    {\n");
+    fprintf(fp, "        %s(in + r * %d, out + r * %d);\n    }\n}\n", name, ann->input_count,
+            ann->output_count);
+    return (ferror(fp) ? -1 : 0);
+}
+
+/* 1 if name is an identifier free for a function in both C and C++ */
+int codegen_name(const char *name)
+{
+    int i;
+
+    if (!isalpha((unsigned char) name[0]) && name[0] != '_')
+    {
+        return (0);
+    }
+    /* Reserved to the implementation */
+    if (name[0] == '_' && (isupper((unsigned char) name[1]) || name[1] == '_'))
+    {
+        return (0);
+    }
+    for (i = 0; i < (int) (sizeof (reserved) / sizeof (reserved[0])); i++)
+    {
+        if (strcmp(name, reserved[i]) == 0)
+        {
+            return (0);
+        }
+    }
+    for (i = 1; name[i] != '\0'; i++)
+    {
+        if (!isalnum((unsigned char) name[i]) && name[i] != '_')
+        {
+            return (0);
+        }
+    }
+    return (1);
+}
+
+/* The activations the layers use, written as activation_apply has them */
+static void codegen_helpers(const Ann *ann, const char *name, FILE *fp)
+{
+    int l, used[ACTIVATION_COUNT] = {0};
+
+    for (l = 0; l < ann->layer_count; l++)
+    {
+        used[ann->layers[l]->activation] = 1;
+    }
+    if (used[ACTIVATION_LOGISTIC])
+    {
+        fprintf(fp, "static inline float %s_logistic(float slope, float x)\n{\n"
+                "    x = x > 45 ? 45 : x;\n    x = x < -45 ? -45 : x;\n"
+                "    return (1 / (1 + expf(slope * x)));\n}\n\n", name);
+    }
+    if (used[ACTIVATION_FAST])
+    {
+        fprintf(fp, "static inline float %s_fast(float slope, float x)\n{\n"
+                "    float t, f, p, scale;\n    int32_t n;\n    uint32_t bits;\n\n"
+                "    x *= slope;\n    x = x < -87.0f ? -87.0f : x;\n    x = x > 87.0f ? 87.0f : x;\n"
+                "    t = x * %.9gf;\n    n = (int32_t) lrintf(t);\n    f = t - (float) n;\n"
+                "    p = ((%.9gf * f + %.9gf) * f + %.9gf) * f + %.9gf;\n"
+                "    bits = (uint32_t) (n + 127) << 23;\n    memcpy(&scale, &bits, sizeof (scale));\n"
+                "    return (1 / (1 + p * scale));\n}\n\n", name, FAST_EXP_LOG2E,
+                FAST_EXP_C3, FAST_EXP_C2, FAST_EXP_C1, FAST_EXP_C0);
+    }
+    if (used[ACTIVATION_TANH])
+    {
+        fprintf(fp, "static inline float %s_tanh(float slope, float x)\n{\n"
+                "    return (tanhf(-slope * x));\n}\n\n", name);
+    }
+    if (used[ACTIVATION_RELU] || used[ACTIVATION_LEAKY])
+    {
+        fprintf(fp, "static inline float %s_relu(float leak, float x)\n{\n"
+                "    return (x > leak * x ? x : leak * x);\n}\n\n", name);
+    }
+}
+
+/* Weights and thresholds of layer l, rows padded to 64 bytes. A looped
+ * layer holds its weights transposed, a row per input */
+static void codegen_arrays(const Layer *layer, const char *name, int l, FILE *fp)
+{
+    int i, j, rows, cols, unrolled = codegen_unrolled(layer);
+    char buf[32];
+
+    rows = unrolled ? layer->count : layer->inputCnt;
+    cols = unrolled ? layer->inputCnt : layer->count;
+    fprintf(fp, "static const float %s_w%d[%d][%d] __attribute__((aligned(64))) = {\n", name, l,
+            rows, (cols + 15) & ~15);
+    for (j = 0; j < rows; j++)
+    {
+        fprintf(fp, "    {");
+        for (i = 0; i < cols; i++)
+        {
+            fprintf(fp, "%s%s", i == 0 ? "" : i % 6 == 0 ? ",\n     " : ", ",
+                    codegen_float(unrolled ? LayerRow(layer, weights, j)[i]
+                                  : LayerRow(layer, weights, i)[j], buf));
+        }
+        fprintf(fp, "}%s\n", j == rows - 1 ? "" : ",");
+    }
+    fprintf(fp, "};\nstatic const float %s_t%d[%d] __attribute__((aligned(64))) = {\n    ", name, l,
+            layer->count);
+    for (j = 0; j < layer->count; j++)
+    {
+        fprintf(fp, "%s%s", j == 0 ? "" : j % 6 == 0 ? ",\n    " : ", ",
+                codegen_float(layer->threshold[j], buf));
+    }
+    fprintf(fp, "\n};\n\n");
+}
+
+/* Layer l reading a<l - 1>, or in for the first, into a<l>, or out for
+ * the last */
+static void codegen_layer(const Layer *layer, const char *name, int l, int last, FILE *fp)
+{
+    int i, j;
+    char in[16], out[16];
+
+    snprintf(in, sizeof (in), l == 0 ? "in" : "a%d", l - 1);
+    snprintf(out, sizeof (out), last ? "out" : "a%d", l);
+    fprintf(fp, "    /* Layer %d, %d x %d */\n", l, layer->count, layer->inputCnt);
+    if (!last)
+    {
+        fprintf(fp, "    float a%d[%d] __attribute__((aligned(64)));\n", l, layer->count);
+    }
+    if (!codegen_unrolled(layer))
+    {
+        /* Each input scaled into every sum, a vector of neurons at a time */
+        fprintf(fp, "    {\n        float s[%d] __attribute__((aligned(64))) = {0};\n\n"
+                "        for (int i = 0; i < %d; i++)\n        {\n"
+                "            for (int j = 0; j < %d; j++)\n            {\n"
+                "                s[j] += %s_w%d[i][j] * %s[i];\n            }\n        }\n"
+                "        for (int j = 0; j < %d; j++)\n        {\n            %s[j] = ",
+                (layer->count + 15) & ~15, layer->inputCnt, (layer->count + 15) & ~15, name, l,
+                in, layer->count, out);
+        codegen_activation(layer, name, fp);
+        fprintf(fp, "s[j] - %s_t%d[j]);\n        }\n    }\n", name, l);
+        return;
+    }
+    for (j = 0; j < layer->count; j++)
+    {
+        fprintf(fp, "    %s[%d] = ", out, j);
+        codegen_activation(layer, name, fp);
+        fprintf(fp, "(");
+        for (i = 0; i < layer->inputCnt; i++)
+        {
+            fprintf(fp, "%s%s_w%d[%d][%d] * %s[%d]", i == 0 ? "" : i % 4 == 0 ? "\n        + " : " + ",
+                    name, l, j, i, in, i);
+        }
+        fprintf(fp, ") - %s_t%d[%d]);\n", name, l, j);
+    }
+}
+
+/* The call opening an activation, up to its argument */
+static void codegen_activation(const Layer *layer, const char *name, FILE *fp)
+{
+    char buf[32];
+
+    switch (layer->activation)
+    {
+    case(ACTIVATION_FAST): fprintf(fp, "%s_fast(%s, ", name, codegen_float(layer->slope, buf));
+        break;
+    case(ACTIVATION_TANH): fprintf(fp, "%s_tanh(%s, ", name, codegen_float(layer->slope, buf));
+        break;
+    case(ACTIVATION_RELU): fprintf(fp, "%s_relu(0.0f, ", name);
+        break;
+    case(ACTIVATION_LEAKY): fprintf(fp, "%s_relu(%s, ", name, codegen_float(ACTIVATION_LEAK, buf));
+        break;
+    default: fprintf(fp, "%s_logistic(%s, ", name, codegen_float(layer->slope, buf));
+    }
+}
+
+/* A float literal that reads back as x exactly */
+static const char * codegen_float(float x, char *buf)
+{
+    int n;
+
+    n = snprintf(buf, 32, "%.9g", x);
+    if (strpbrk(buf, ".e") == NULL)
+    {
+        strcpy(buf + n, ".0");
+        n += 2;
+    }
+    strcpy(buf + n, "f");
+    return (buf);
+}
+
+/* 1 if layer is written out term by term rather than looped */
+static int codegen_unrolled(const Layer *layer)
+{
+    return ((long) layer->count * layer->inputCnt <= CODEGEN_UNROLL);
+}
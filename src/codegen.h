@@ -0,0 +1,42 @@
+/*
+ * File: codegen.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * C source for one trained network with its shape fixed at compile time.
+ * AnnCodegen writes a self contained file, C99 or C++ for GCC and Clang,
+ * holding the parameters as 64 byte aligned static const arrays and two
+ * functions,
+ *
+ *   void name(const float *in, float *out);
+ *   void name_batch(const float *in, long rows, float *out);
+ *
+ * in holding NAME_INPUTS floats per row and out NAME_OUTPUTS. Every
+ * dimension is a constant. Layers of up to CODEGEN_UNROLL weights are
+ * unrolled completely, one expression per neuron with the weights indexed
+ * by constants, so the compiler folds them into the instructions; larger
+ * layers keep their weights transposed and loop over the inputs, adding
+ * each into a vector of neuron sums, constant bounds the compiler
+ * vectorises without reordering any sum. The functions
+ * allocate nothing, hold no state and take no branches beyond the clamps
+ * of the activations, which match activation_apply.
+ *
+ * Sums run in input order, the kernel tables may add in another order, so
+ * outputs agree with ann_predict to a few ulps, not bit for bit.
+ */
+#ifndef CODEGEN_H
+#define	CODEGEN_H
+
+#include "ann.h"
+/* Most weights of a layer written out term by term */
+#define CODEGEN_UNROLL      1024
+
+/* Prototypes */
+int codegen_write(const Ann * ann, const char *name, FILE * fp);
+int codegen_name(const char *name);
+/* Macros */
+#define AnnCodegen(this, name, fp)  ((codegen_write)(this, name, fp))
+
+#endif	/* CODEGEN_H */
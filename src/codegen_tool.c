@@ -0,0 +1,66 @@
+/*
+ * File: codegen_tool.c
+ * Program: ann_codegen
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Writes a trained model out as C source, see codegen.h. The function is
+ * called name, the dimension macros NAME_INPUTS and NAME_OUTPUTS.
+ *
+ * Usage: ann_codegen [-o file] model name
+ * The source goes to standard output without -o.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "ann.h"
+#include "model.h"
+#include "codegen.h"
+
+int main(int argc, char *argv[])
+{
+    int opt, failed;
+    const char *path = NULL;
+    FILE *fp = stdout;
+    Ann *ann;
+
+    while ((opt = getopt(argc, argv, "o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'o': path = optarg;
+            break;
+        default: fprintf(stderr, "Usage: %s [-o file] model name\n", argv[0]);
+            return (EXIT_FAILURE);
+        }
+    }
+    if (argc - optind != 2)
+    {
+        fprintf(stderr, "Usage: %s [-o file] model name\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+    if (!codegen_name(argv[optind + 1]))
+    {
+        fprintf(stderr, "ann_codegen: %s is not a C identifier or is reserved\n", argv[optind + 1]);
+        return (EXIT_FAILURE);
+    }
+    ann = AnnLoad(argv[optind]);
+    if (ann == NULL)
+    {
+        return (EXIT_FAILURE);
+    }
+    if (path != NULL && (fp = fopen(path, "w")) == NULL)
+    {
+        fprintf(stderr, "ann_codegen: Cannot create %s\n", path);
+        AnnDestroy(ann);
+        return (EXIT_FAILURE);
+    }
+    failed = AnnCodegen(ann, argv[optind + 1], fp) != 0;
+    if (path != NULL)
+    {
+        failed |= fclose(fp) != 0;
+    }
+    AnnDestroy(ann);
+    return (failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
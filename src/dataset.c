@@ -0,0 +1,641 @@
+/*
+ * File: dataset.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#define _FILE_OFFSET_BITS 64
+#include <string.h>
+#include <sys/types.h>
+#include "dataset.h"
+
+/* Prototypes */
+static void dataset_destruct(Dataset *this);
+static void * dataset_reader(void *arg);
+static int dataset_wait_empty(Dataset *this, int w);
+static void dataset_publish(Dataset *this, int w, int rows);
+static int dataset_read_binary(Dataset *this, FILE *fp, float *stage, int c);
+static int dataset_read_csv(Dataset *this, FILE *fp, float *stage, char **line, size_t *line_size,
+                            long *skipped);
+static void dataset_index(Dataset *this, off_t start);
+static int dataset_scatter(Dataset *this, DatasetChunk *chunk, int c, int rows);
+static int dataset_held(const Dataset *this, int64_t row);
+static void dataset_shuffle(int *a, int n, Random *random);
+static int dataset_parse(const char *line, float *row, int width);
+static int dataset_open(Dataset *this, const char *path);
+static void * dataset_alloc(size_t size);
+
+/* Instantiate a new object, NULL if path cannot be read as a data set */
+Dataset * dataset_construct(const char *path, int input_count, int output_count,
+                            int chunk_rows, unsigned int seed)
+{
+    return (dataset_construct_split(path, input_count, output_count, chunk_rows, seed, 0));
+}
+
+/* The same holding out a share of the rows, 0 to 1, for validation */
+Dataset * dataset_construct_split(const char *path, int input_count, int output_count,
+                                  int chunk_rows, unsigned int seed, float holdout)
+{
+    int i, width;
+    Dataset *this = NULL;
+    /* Allocate memory */
+    this = (Dataset *) malloc(sizeof (Dataset));
+    if (this == NULL)
+    {
+        printf("Dataset: ::dataset_construct_split Memory allocation failed");
+        exit(1);
+    }
+    /* Set initial values for data members */
+    this->cls = DATASET;
+    this->input_count = input_count;
+    this->output_count = output_count;
+    this->chunk_rows = chunk_rows > 0 ? chunk_rows : 4096;
+    this->offsets = NULL;
+    this->order = NULL;
+    this->chunk_count = 0;
+    this->chunk_cap = 0;
+    random_seed(&this->random, seed, RANDOM_STREAM_DATASET);
+    this->line = NULL;
+    this->line_size = 0;
+    this->next = 0;
+    this->held = -1;
+    this->epoch = 0;
+    this->samples = 0;
+    this->holdout = holdout > 0 ? (holdout < 1 ? holdout : 1) : 0;
+    this->valid_fp = NULL;
+    this->valid_chunk = 0;
+    this->valid_stage = NULL;
+    this->valid_inputs = NULL;
+    this->valid_targets = NULL;
+    this->valid_line = NULL;
+    this->valid_line_size = 0;
+    this->skipped = 0;
+    this->quit = 0;
+    this->dispatcher = (void *) dataset_dispatcher; /* Add the dispatcher pointer */
+    if (dataset_open(this, path) != 0)
+    {
+        free(this);
+        return (NULL);
+    }
+    /* The split is read back through a handle of its own */
+    if (this->holdout > 0 && (this->valid_fp = fopen(path, "rb")) == NULL)
+    {
+        printf("Dataset: ::dataset_construct_split Cannot open %s\n", path);
+        fclose(this->fp);
+        free(this->order);
+        free(this);
+        return (NULL);
+    }
+
+    width = input_count + output_count;
+    this->stage = dataset_alloc((size_t) this->chunk_rows * width * sizeof (float));
+    this->perm = dataset_alloc(this->chunk_rows * sizeof (int));
+    for (i = 0; i < 2; i++)
+    {
+        this->chunk[i].inputs = dataset_alloc((size_t) this->chunk_rows * input_count * sizeof (float));
+        this->chunk[i].targets = dataset_alloc((size_t) this->chunk_rows * output_count * sizeof (float));
+        this->chunk[i].rows = 0;
+        this->chunk[i].full = 0;
+    }
+    if (this->valid_fp != NULL)
+    {
+        this->valid_stage = dataset_alloc((size_t) this->chunk_rows * width * sizeof (float));
+        this->valid_inputs = dataset_alloc((size_t) this->chunk_rows * input_count * sizeof (float));
+        this->valid_targets = dataset_alloc((size_t) this->chunk_rows * output_count * sizeof (float));
+    }
+    pthread_mutex_init(&this->lock, NULL);
+    pthread_cond_init(&this->filled, NULL);
+    pthread_cond_init(&this->emptied, NULL);
+    if (pthread_create(&this->reader, NULL, dataset_reader, this) != 0)
+    {
+        printf("Dataset: ::dataset_construct_split Thread creation failed");
+        exit(1);
+    }
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Stop the reader and free the memory */
+static void dataset_destruct(Dataset *this)
+{
+    int i;
+
+    pthread_mutex_lock(&this->lock);
+    this->quit = 1;
+    pthread_cond_broadcast(&this->emptied);
+    pthread_mutex_unlock(&this->lock);
+    pthread_join(this->reader, NULL);
+    pthread_mutex_destroy(&this->lock);
+    pthread_cond_destroy(&this->filled);
+    pthread_cond_destroy(&this->emptied);
+    fclose(this->fp);
+    if (this->valid_fp != NULL)
+    {
+        fclose(this->valid_fp);
+    }
+    for (i = 0; i < 2; i++)
+    {
+        free(this->chunk[i].inputs);
+        free(this->chunk[i].targets);
+    }
+    free(this->offsets);
+    free(this->order);
+    free(this->stage);
+    free(this->perm);
+    free(this->line);
+    free(this->valid_stage);
+    free(this->valid_inputs);
+    free(this->valid_targets);
+    free(this->valid_line);
+    free(this);
+}
+
+/*
+ * Hand out the next chunk, inputs rows x input_count and targets rows x
+ * output_count. They stay valid until the following call, which gives the
+ * buffer back to the reader. Returns the row count, 0 once at the end of
+ * each epoch after which the next epoch begins.
+ */
+int dataset_next(Dataset *this, const float **inputs, const float **targets)
+{
+    int rows;
+    DatasetChunk *chunk;
+
+    pthread_mutex_lock(&this->lock);
+    if (this->held >= 0)
+    {
+        this->chunk[this->held].full = 0;
+        this->held = -1;
+        pthread_cond_signal(&this->emptied);
+    }
+    chunk = &this->chunk[this->next];
+    while (!chunk->full)
+    {
+        pthread_cond_wait(&this->filled, &this->lock);
+    }
+    rows = chunk->rows;
+    if (rows == 0)
+    {
+        /* End of epoch marker, nothing to hold on to */
+        chunk->full = 0;
+        this->epoch++;
+        pthread_cond_signal(&this->emptied);
+    }
+    else
+    {
+        this->held = this->next;
+        this->samples += rows;
+    }
+    this->next ^= 1;
+    pthread_mutex_unlock(&this->lock);
+    *inputs = chunk->inputs;
+    *targets = chunk->targets;
+    return (rows);
+}
+
+/*
+ * Hand out the held out rows of the next chunk, in file order, inputs rows
+ * x input_count and targets rows x output_count, valid until the following
+ * call. Returns the row count, 0 once at the end of the split after which
+ * the next call starts it again. The rows are read back from the file, not
+ * kept, on the calling thread while the reader carries on. None until the
+ * caller has seen the end of the first epoch and every chunk is located.
+ */
+int dataset_validation(Dataset *this, const float **inputs, const float **targets)
+{
+    int r, c, rows, kept = 0, width = this->input_count + this->output_count;
+    long epoch;
+    const float *row;
+
+    pthread_mutex_lock(&this->lock);
+    epoch = this->epoch;
+    pthread_mutex_unlock(&this->lock);
+    *inputs = this->valid_inputs;
+    *targets = this->valid_targets;
+    if (this->valid_fp == NULL || epoch == 0)
+    {
+        return (0);
+    }
+    while (kept == 0 && this->valid_chunk < this->chunk_count)
+    {
+        c = this->valid_chunk++;
+        rows = 0;
+        if (this->binary)
+        {
+            rows = dataset_read_binary(this, this->valid_fp, this->valid_stage, c);
+        }
+        else if (fseeko(this->valid_fp, this->offsets[c], SEEK_SET) == 0)
+        {
+            rows = dataset_read_csv(this, this->valid_fp, this->valid_stage, &this->valid_line,
+                                    &this->valid_line_size, NULL);
+        }
+        for (r = 0; r < rows; r++)
+        {
+            if (!dataset_held(this, (int64_t) c * this->chunk_rows + r))
+            {
+                continue;
+            }
+            row = this->valid_stage + (size_t) r * width;
+            memcpy(this->valid_inputs + (size_t) kept * this->input_count, row,
+                   this->input_count * sizeof (float));
+            memcpy(this->valid_targets + (size_t) kept * this->output_count, row + this->input_count,
+                   this->output_count * sizeof (float));
+            kept++;
+        }
+    }
+    if (kept == 0)
+    {
+        this->valid_chunk = 0;
+    }
+    return (kept);
+}
+
+/* Background reader, fills the two chunks in turn epoch after epoch */
+static void * dataset_reader(void *arg)
+{
+    Dataset *this = arg;
+    int i, w = 0, rows, count;
+    off_t start;
+
+    for (;;)
+    {
+        /* Once every chunk start is known they can be visited in any order */
+        count = this->chunk_count;
+        for (i = 0; i < count; i++)
+        {
+            this->order[i] = i;
+        }
+        if (this->indexed)
+        {
+            dataset_shuffle(this->order, count, &this->random);
+        }
+        else
+        {
+            fseeko(this->fp, 0, SEEK_SET);
+        }
+        for (i = 0; !this->indexed || i < count; i++)
+        {
+            if (dataset_wait_empty(this, w) != 0)
+            {
+                return (NULL);
+            }
+            if (this->binary)
+            {
+                rows = dataset_read_binary(this, this->fp, this->stage, this->order[i]);
+            }
+            else
+            {
+                if (this->indexed)
+                {
+                    fseeko(this->fp, this->offsets[this->order[i]], SEEK_SET);
+                }
+                start = ftello(this->fp);
+                rows = dataset_read_csv(this, this->fp, this->stage, &this->line, &this->line_size,
+                                        this->indexed ? NULL : &this->skipped);
+                /* Remember where each chunk starts while the first epoch
+                 * reads them */
+                if (!this->indexed && rows > 0)
+                {
+                    dataset_index(this, start);
+                }
+            }
+            if (rows == 0)
+            {
+                break;
+            }
+            /* Chunks are numbered by position in the file */
+            rows = dataset_scatter(this, &this->chunk[w], this->indexed ? this->order[i] : i, rows);
+            if (rows == 0)
+            {
+                continue;
+            }
+            dataset_publish(this, w, rows);
+            w ^= 1;
+        }
+        /* A CSV file has now been read through and every chunk located */
+        if (!this->indexed && this->skipped > 0)
+        {
+            printf("Dataset: ::dataset_reader %ld lines skipped, not %d comma separated numbers\n",
+                   this->skipped, this->input_count + this->output_count);
+        }
+        this->indexed = 1;
+        if (dataset_wait_empty(this, w) != 0)
+        {
+            return (NULL);
+        }
+        dataset_publish(this, w, 0);
+        w ^= 1;
+    }
+}
+
+/* Block until chunk w has been handed back, non zero when shutting down */
+static int dataset_wait_empty(Dataset *this, int w)
+{
+    int quit;
+
+    pthread_mutex_lock(&this->lock);
+    while (!this->quit && this->chunk[w].full)
+    {
+        pthread_cond_wait(&this->emptied, &this->lock);
+    }
+    quit = this->quit;
+    pthread_mutex_unlock(&this->lock);
+    return (quit);
+}
+
+static void dataset_publish(Dataset *this, int w, int rows)
+{
+    pthread_mutex_lock(&this->lock);
+    this->chunk[w].rows = rows;
+    this->chunk[w].full = 1;
+    pthread_cond_signal(&this->filled);
+    pthread_mutex_unlock(&this->lock);
+}
+
+/* Read chunk c of a binary file from fp into stage, returns the row
+ * count */
+static int dataset_read_binary(Dataset *this, FILE *fp, float *stage, int c)
+{
+    int width = this->input_count + this->output_count;
+    int64_t first = (int64_t) c * this->chunk_rows;
+    int rows = this->rows - first < this->chunk_rows ? (int) (this->rows - first) : this->chunk_rows;
+    off_t at = sizeof (DatasetHeader) + first * width * (off_t) sizeof (float);
+
+    if (fseeko(fp, at, SEEK_SET) != 0
+        || fread(stage, sizeof (float) * width, rows, fp) != (size_t) rows)
+    {
+        printf("Dataset: ::dataset_read_binary Read failed\n");
+        return (0);
+    }
+    return (rows);
+}
+
+/* Read up to a chunk of samples from the current CSV position of fp into
+ * stage, line being the line buffer of fp. Malformed lines are counted in
+ * skipped unless it is NULL. */
+static int dataset_read_csv(Dataset *this, FILE *fp, float *stage, char **line, size_t *line_size,
+                            long *skipped)
+{
+    int rows = 0, result, width = this->input_count + this->output_count;
+
+    while (rows < this->chunk_rows && getline(line, line_size, fp) > 0)
+    {
+        result = dataset_parse(*line, stage + (size_t) rows * width, width);
+        if (result == 0)
+        {
+            rows++;
+        }
+        else if (result < 0 && skipped != NULL)
+        {
+            (*skipped)++;
+        }
+    }
+    return (rows);
+}
+
+/* Record the start of the next CSV chunk */
+static void dataset_index(Dataset *this, off_t start)
+{
+    if (this->chunk_count == this->chunk_cap)
+    {
+        this->chunk_cap = this->chunk_cap ? this->chunk_cap * 2 : 64;
+        this->offsets = realloc(this->offsets, this->chunk_cap * sizeof (int64_t));
+        this->order = realloc(this->order, this->chunk_cap * sizeof (int));
+        if (this->offsets == NULL || this->order == NULL)
+        {
+            printf("Dataset: ::dataset_index Memory allocation failed");
+            exit(1);
+        }
+    }
+    this->offsets[this->chunk_count++] = start;
+}
+
+/* Split the staged rows of chunk c into inputs and targets in a random
+ * order, leaving out the held out rows. Returns the rows left. */
+static int dataset_scatter(Dataset *this, DatasetChunk *chunk, int c, int rows)
+{
+    int r, kept = 0, width = this->input_count + this->output_count;
+    const float *row;
+
+    for (r = 0; r < rows; r++)
+    {
+        if (this->holdout > 0 && dataset_held(this, (int64_t) c * this->chunk_rows + r))
+        {
+            continue;
+        }
+        this->perm[kept++] = r;
+    }
+    rows = kept;
+    dataset_shuffle(this->perm, rows, &this->random);
+    for (r = 0; r < rows; r++)
+    {
+        row = this->stage + (size_t) this->perm[r] * width;
+        memcpy(chunk->inputs + (size_t) r * this->input_count, row,
+               this->input_count * sizeof (float));
+        memcpy(chunk->targets + (size_t) r * this->output_count, row + this->input_count,
+               this->output_count * sizeof (float));
+    }
+    return (rows);
+}
+
+/* 1 if row, counted from the start of the file, is held out. The top 24
+ * bits of a splitmix64 hash of the row against the share; the hash of row
+ * is output row + 1 of the splitmix64 sequence, as a product of row alone
+ * would send row 0 to 0 and hold it out at any share. */
+static int dataset_held(const Dataset *this, int64_t row)
+{
+    uint64_t z = (uint64_t) (row + 1) * 0x9e3779b97f4a7c15ULL;
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return ((z >> 40) < (uint64_t) (this->holdout * 16777216.0f));
+}
+
+/* Fisher-Yates shuffle of n ints */
+static void dataset_shuffle(int *a, int n, Random *random)
+{
+    int i, j, t;
+
+    for (i = n - 1; i > 0; i--)
+    {
+        j = random_below(random, i + 1);
+        t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+    }
+}
+
+/* Parse width comma separated values, 1 for a blank line and -1 for a
+ * malformed one */
+static int dataset_parse(const char *line, float *row, int width)
+{
+    int i;
+    char *end;
+
+    if (line[strspn(line, " \t\r\n")] == '\0')
+    {
+        return (1);
+    }
+    for (i = 0; i < width; i++)
+    {
+        row[i] = strtof(line, &end);
+        if (end == line)
+        {
+            return (-1);
+        }
+        line = end;
+        while (*line == ' ' || *line == '\t')
+        {
+            line++;
+        }
+        if (i < width - 1)
+        {
+            if (*line != ',')
+            {
+                return (-1);
+            }
+            line++;
+        }
+    }
+    return (*line == '\0' || *line == '\n' || *line == '\r' ? 0 : -1);
+}
+
+/* Open path and work out its format, non zero if it cannot be used */
+static int dataset_open(Dataset *this, const char *path)
+{
+    int i;
+    off_t size;
+    DatasetHeader head;
+
+    this->fp = fopen(path, "rb");
+    if (this->fp == NULL)
+    {
+        printf("Dataset: ::dataset_open Cannot open %s\n", path);
+        return (-1);
+    }
+    this->binary = fread(&head, sizeof (head), 1, this->fp) == 1
+            && memcmp(head.magic, DATASET_MAGIC, sizeof (head.magic)) == 0;
+    this->indexed = this->binary;
+    this->rows = 0;
+    if (!this->binary)
+    {
+        return (0);
+    }
+    fseeko(this->fp, 0, SEEK_END);
+    size = ftello(this->fp);
+    if (head.endian != DATASET_ENDIAN || head.version != DATASET_VERSION
+        || head.input_count != (uint32_t) this->input_count
+        || head.output_count != (uint32_t) this->output_count
+        || (uint64_t) (size - sizeof (head)) / ((this->input_count + this->output_count) * sizeof (float)) < head.rows)
+    {
+        printf("Dataset: ::dataset_open %s does not match the network\n", path);
+        fclose(this->fp);
+        return (-1);
+    }
+    this->rows = head.rows;
+    this->chunk_count = (this->rows + this->chunk_rows - 1) / this->chunk_rows;
+    this->chunk_cap = this->chunk_count;
+    this->order = dataset_alloc(this->chunk_count * sizeof (int));
+    for (i = 0; i < this->chunk_count; i++)
+    {
+        this->order[i] = i;
+    }
+    return (0);
+}
+
+/* Convert the CSV file csv to the packed binary file path, 0 or -1 */
+int dataset_pack(const char *csv, const char *path, int input_count, int output_count)
+{
+    int width = input_count + output_count;
+    char *line = NULL;
+    size_t line_size = 0;
+    float *row;
+    FILE *in, *out;
+    DatasetHeader head;
+    int result = 0, parsed;
+    long skipped = 0;
+
+    in = fopen(csv, "r");
+    if (in == NULL)
+    {
+        printf("Dataset: ::dataset_pack Cannot open %s\n", csv);
+        return (-1);
+    }
+    out = fopen(path, "wb");
+    if (out == NULL)
+    {
+        printf("Dataset: ::dataset_pack Cannot create %s\n", path);
+        fclose(in);
+        return (-1);
+    }
+    row = dataset_alloc(width * sizeof (float));
+    memset(&head, 0, sizeof (head));
+    memcpy(head.magic, DATASET_MAGIC, sizeof (head.magic));
+    head.endian = DATASET_ENDIAN;
+    head.version = DATASET_VERSION;
+    head.input_count = input_count;
+    head.output_count = output_count;
+    /* Header is rewritten with the row count at the end */
+    if (fwrite(&head, sizeof (head), 1, out) != 1)
+    {
+        result = -1;
+    }
+    while (result == 0 && getline(&line, &line_size, in) > 0)
+    {
+        parsed = dataset_parse(line, row, width);
+        skipped += parsed < 0;
+        if (parsed != 0)
+        {
+            continue;
+        }
+        if (fwrite(row, sizeof (float), width, out) != (size_t) width)
+        {
+            result = -1;
+        }
+        head.rows++;
+    }
+    if (result == 0 && (fseeko(out, 0, SEEK_SET) != 0 || fwrite(&head, sizeof (head), 1, out) != 1))
+    {
+        result = -1;
+    }
+    if (fclose(out) != 0 || result != 0)
+    {
+        printf("Dataset: ::dataset_pack Write to %s failed\n", path);
+        result = -1;
+    }
+    if (skipped > 0)
+    {
+        printf("Dataset: ::dataset_pack %ld lines of %s skipped, not %d comma separated numbers\n",
+               skipped, csv, width);
+    }
+    fclose(in);
+    free(line);
+    free(row);
+    return (result);
+}
+
+/* Allocation that exits on failure like the constructors */
+static void * dataset_alloc(size_t size)
+{
+    void *ptr = malloc(size ? size : 1);
+
+    if (ptr == NULL)
+    {
+        printf("Dataset: ::dataset_alloc Memory allocation failed");
+        exit(1);
+    }
+    return (ptr);
+}
+
+void dataset_dispatcher(Dataset *this, int mthd, int attr, void *msg)
+{
+    switch (mthd)
+    {
+    case(DATASET_DESTROY): dataset_destruct(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Dataset: ::dataset_dispatcher: Unknown method %d\n", mthd);
+    }
+}
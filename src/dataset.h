@@ -0,0 +1,139 @@
+/*
+ * File: dataset.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Streaming training data. Samples are read a chunk of rows at a time by a
+ * background thread into one half of a double buffer while the trainer
+ * works through the other half, so only two chunks are ever resident and
+ * sets far larger than memory can be used.
+ *
+ * Two file formats are read. CSV has one sample per line, the inputs then
+ * the targets, comma separated. The packed binary format is a DatasetHeader
+ * followed by the same values as raw host order floats; dataset_pack, or
+ * the ann_pack tool, converts a CSV file to it. Binary files are faster to
+ * read and can be shuffled from the first epoch, CSV chunk positions are
+ * only known once the first epoch has been read through. Lines that are
+ * not input_count + output_count numbers are skipped, and their count is
+ * printed once the first epoch, or the conversion, has read them all.
+ *
+ * The stream runs on across epochs. Each epoch visits the chunks in a new
+ * random order and the rows of each chunk in a new random order; the end
+ * of an epoch is reported once by dataset_next returning 0.
+ *
+ * DatasetNewSplit holds a share of the rows out for validation. A row is
+ * held out by a hash of its position in the file, so the split is the same
+ * every epoch and every run; held out rows never reach dataset_next. They
+ * are not kept in memory: dataset_validation reads them back a chunk at a
+ * time through a file handle of its own, from the end of the first epoch
+ * on, so the split costs one chunk however large the file.
+ */
+#ifndef DATASET_H
+#define	DATASET_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "random.h"
+/* Class Id */
+#define DATASET             (('D'+'A'+'T'+'A'+'S'+'E'+'T') << 16)
+/* Methods */
+#define DATASET_DESTROY     DATASET + 1
+/* Packed binary format */
+#define DATASET_MAGIC       "ANND"
+#define DATASET_ENDIAN      0x01020304u
+#define DATASET_VERSION     1
+
+/* Forward declarations */
+typedef struct _Dataset Dataset;
+
+/* Packed binary file header, rows x (input_count + output_count) floats follow */
+typedef struct
+{
+    char magic[4];
+    uint32_t endian;
+    uint32_t version;
+    uint32_t input_count;
+    uint32_t output_count;
+    uint32_t reserved;
+    uint64_t rows;
+} DatasetHeader;
+
+/* One half of the double buffer */
+typedef struct
+{
+    float *inputs;      /* rows x input_count */
+    float *targets;     /* rows x output_count */
+    int rows;           /* 0 marks the end of an epoch */
+    int full;           /* Filled by the reader, not yet handed back */
+} DatasetChunk;
+
+struct _Dataset
+{
+    int cls;
+    int input_count;
+    int output_count;
+    int chunk_rows;     /* Rows read per chunk */
+    int binary;         /* Packed binary rather than CSV */
+    FILE *fp;
+    int64_t rows;       /* Samples in a binary file */
+    /* Start of every CSV chunk, recorded as the first epoch reads them */
+    int64_t *offsets;
+    int chunk_count;
+    int chunk_cap;
+    int indexed;        /* Every chunk start is known, chunks can be shuffled */
+    int *order;         /* Chunk visiting order of the current epoch */
+    Random random;      /* Shuffle state, only the reader thread uses it */
+    float *stage;       /* Raw rows of the chunk being read */
+    int *perm;          /* Row order within a chunk */
+    char *line;         /* CSV line buffer */
+    size_t line_size;
+    long skipped;       /* Malformed CSV lines of the first epoch */
+    /* Double buffer, the reader fills them in turn and dataset_next
+     * hands them out in the same turn */
+    DatasetChunk chunk[2];
+    int next;           /* Chunk dataset_next hands out next */
+    int held;           /* Chunk the caller holds, -1 for none */
+    long epoch;         /* Epochs completed by the caller */
+    long samples;       /* Samples handed out */
+    /* Validation split, read back by the caller's thread */
+    float holdout;      /* Share of rows held out, 0 for none */
+    FILE *valid_fp;     /* Own handle, NULL without a split */
+    int valid_chunk;    /* Next chunk of the split in file order */
+    float *valid_stage; /* Raw rows of that chunk */
+    float *valid_inputs;    /* Its held out rows, chunk_rows x input_count */
+    float *valid_targets;   /* chunk_rows x output_count */
+    char *valid_line;   /* CSV line buffer of valid_fp */
+    size_t valid_line_size;
+    pthread_t reader;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t emptied;
+    int quit;
+    void (*dispatcher)(Dataset * this, int mthd, int attr, void * msg);
+};
+
+/* Prototypes */
+Dataset * dataset_construct(const char *path, int input_count, int output_count,
+                            int chunk_rows, unsigned int seed);
+Dataset * dataset_construct_split(const char *path, int input_count, int output_count,
+                                  int chunk_rows, unsigned int seed, float holdout);
+void dataset_dispatcher(Dataset * this, int mthd, int attr, void * msg);
+int dataset_next(Dataset * this, const float **inputs, const float **targets);
+int dataset_validation(Dataset * this, const float **inputs, const float **targets);
+int dataset_pack(const char *csv, const char *path, int input_count, int output_count);
+/* Macros */
+#define DatasetNew(path, input_count, output_count, chunk_rows, seed) \
+    ((dataset_construct)(path, input_count, output_count, chunk_rows, seed))
+#define DatasetNewSplit(path, input_count, output_count, chunk_rows, seed, holdout) \
+    ((dataset_construct_split)(path, input_count, output_count, chunk_rows, seed, holdout))
+#define DatasetDestroy(this)                ((this->dispatcher)(this, DATASET_DESTROY, 0, NULL))
+#define DatasetNext(this, inputs, targets)  ((dataset_next)(this, inputs, targets))
+#define DatasetValidation(this, inputs, targets) ((dataset_validation)(this, inputs, targets))
+#define DatasetPack(csv, path, input_count, output_count) \
+    ((dataset_pack)(csv, path, input_count, output_count))
+
+#endif	/* DATASET_H */
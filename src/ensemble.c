@@ -0,0 +1,263 @@
+/*
+ * File: ensemble.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include <string.h>
+#include "ensemble.h"
+#include "kernel.h"
+
+/* Prototypes */
+static void ensemble_destruct(Ensemble *this);
+static int ensemble_lanes(int models);
+static int ensemble_matches(Ann **anns, int models);
+static void ensemble_layer(EnsembleLayer *e, Arena *arena, Ann **anns, int models, int lanes, int l);
+static void ensemble_aggregate(Ensemble *this, const float *out, float *result);
+
+/* Instantiate an ensemble of models networks of one shape, NULL if their
+ * shapes differ. The networks themselves are not changed. */
+Ensemble * ensemble_construct(Ann **anns, int models, int aggregate)
+{
+    int l, lanes, stride, widest;
+    size_t bytes;
+    Layer *layer;
+    Ensemble *this = NULL;
+
+    if (models < 1 || !ensemble_matches(anns, models))
+    {
+        return (NULL);
+    }
+    /* Allocate memory */
+    this = (Ensemble *) malloc(sizeof (Ensemble));
+    if (this == NULL)
+    {
+        printf("Ensemble: ::ensemble_construct Memory allocation failed");
+        exit(1);
+    }
+    /* Set initial values for data members */
+    this->cls = ENSEMBLE;
+    this->models = models;
+    this->lanes = lanes = ensemble_lanes(models);
+    this->aggregate = aggregate;
+    this->input_count = anns[0]->input_count;
+    this->output_count = anns[0]->output_count;
+    this->layer_count = anns[0]->layer_count;
+    this->dispatcher = (void *) ensemble_dispatcher; /* Add the dispatcher pointer */
+    /* One arena for the parameters and the scratch */
+    widest = this->input_count;
+    bytes = arena_round(this->layer_count * sizeof (EnsembleLayer));
+    for (l = 0; l < this->layer_count; l++)
+    {
+        layer = anns[0]->layers[l];
+        stride = arena_round((size_t) layer->inputCnt * lanes * sizeof (float)) / sizeof (float);
+        bytes += arena_round((size_t) layer->count * stride * sizeof (float))
+                + arena_round((size_t) layer->count * lanes * sizeof (float));
+        widest = layer->count > widest ? layer->count : widest;
+    }
+    bytes += 2 * arena_round((size_t) widest * lanes * sizeof (float))
+            + arena_round(this->output_count * sizeof (float));
+    arena_open(&this->arena, bytes);
+    this->layers = arena_take(&this->arena, this->layer_count * sizeof (EnsembleLayer));
+    for (l = 0; l < this->layer_count; l++)
+    {
+        ensemble_layer(&this->layers[l], &this->arena, anns, models, lanes, l);
+    }
+    this->act[0] = arena_take(&this->arena, (size_t) widest * lanes * sizeof (float));
+    this->act[1] = arena_take(&this->arena, (size_t) widest * lanes * sizeof (float));
+    this->votes = arena_take(&this->arena, this->output_count * sizeof (float));
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Do any clean up needed and free the memory */
+static void ensemble_destruct(Ensemble *this)
+{
+    arena_close(&this->arena);
+    free(this);
+}
+
+/* Vector lanes for models side by side */
+static int ensemble_lanes(int models)
+{
+    int lanes = 1;
+
+    if (models > 16)
+    {
+        return ((models + 15) & ~15);
+    }
+    while (lanes < models)
+    {
+        lanes *= 2;
+    }
+    return (lanes);
+}
+
+/* 1 if every network has the shape of the first */
+static int ensemble_matches(Ann **anns, int models)
+{
+    int k, l;
+    const Layer *a, *b;
+
+    for (k = 1; k < models; k++)
+    {
+        if (anns[k]->layer_count != anns[0]->layer_count)
+        {
+            printf("Ensemble: model %d has %d layers, model 0 has %d\n", k,
+                   anns[k]->layer_count, anns[0]->layer_count);
+            return (0);
+        }
+        for (l = 0; l < anns[0]->layer_count; l++)
+        {
+            a = anns[0]->layers[l];
+            b = anns[k]->layers[l];
+            if (a->count != b->count || a->inputCnt != b->inputCnt
+                || a->activation != b->activation || a->slope != b->slope)
+            {
+                printf("Ensemble: layer %d of model %d differs from model 0\n", l, k);
+                return (0);
+            }
+        }
+    }
+    return (1);
+}
+
+/* Interleave layer l of every model into e, the arena is zeroed so the
+ * padding models and columns are left as they are */
+static void ensemble_layer(EnsembleLayer *e, Arena *arena, Ann **anns, int models, int lanes, int l)
+{
+    int j, i, k;
+    const Layer *layer;
+    const float *row;
+    float *dest;
+
+    layer = anns[0]->layers[l];
+    e->count = layer->count;
+    e->inputCnt = layer->inputCnt;
+    e->stride = arena_round((size_t) e->inputCnt * lanes * sizeof (float)) / sizeof (float);
+    e->activation = layer->activation;
+    e->slope = layer->slope;
+    e->weights = arena_take(arena, (size_t) e->count * e->stride * sizeof (float));
+    e->threshold = arena_take(arena, (size_t) e->count * lanes * sizeof (float));
+    for (k = 0; k < models; k++)
+    {
+        layer = anns[k]->layers[l];
+        for (j = 0; j < e->count; j++)
+        {
+            row = LayerRow(layer, weights, j);
+            dest = e->weights + (size_t) j * e->stride + k;
+            for (i = 0; i < e->inputCnt; i++)
+            {
+                dest[(size_t) i * lanes] = row[i];
+            }
+            e->threshold[(size_t) j * lanes + k] = layer->threshold[j];
+        }
+    }
+}
+
+/* Evaluate rows input vectors through every model. inputs is rows x
+ * input_count; outputs, if not NULL, rows x models x output_count, the
+ * outputs of model k of row r at (r * models + k) * output_count; result,
+ * if not NULL, rows x output_count of aggregates. */
+void ensemble_forward(Ensemble *this, const float *inputs, int rows, float *outputs,
+                      float *result)
+{
+    int r, l, i, j, k, lanes = this->lanes;
+    const float *in;
+    float *x, *out = NULL;
+    const EnsembleLayer *e;
+    void (*dot_lanes)(const float *, const float *, int, int, float *) = kernel_ops->dot_lanes;
+
+    for (r = 0; r < rows; r++)
+    {
+        /* Every model sees the same inputs */
+        in = inputs + (size_t) r * this->input_count;
+        x = this->act[1];
+        for (i = 0; i < this->input_count; i++)
+        {
+            for (k = 0; k < lanes; k++)
+            {
+                x[(size_t) i * lanes + k] = in[i];
+            }
+        }
+        for (l = 0; l < this->layer_count; l++)
+        {
+            e = &this->layers[l];
+            out = this->act[l & 1];
+            for (j = 0; j < e->count; j++)
+            {
+                dot_lanes(e->weights + (size_t) j * e->stride, x, e->inputCnt * lanes, lanes,
+                          out + (size_t) j * lanes);
+            }
+            kernel_bias_activation(out, 1, e->count * lanes, e->count * lanes, e->threshold,
+                                   e->slope, e->activation);
+            x = out;
+        }
+        if (outputs != NULL)
+        {
+            for (k = 0; k < this->models; k++)
+            {
+                for (j = 0; j < this->output_count; j++)
+                {
+                    outputs[((size_t) r * this->models + k) * this->output_count + j]
+                            = out[(size_t) j * lanes + k];
+                }
+            }
+        }
+        if (result != NULL)
+        {
+            ensemble_aggregate(this, out, result + (size_t) r * this->output_count);
+        }
+    }
+}
+
+/* Mean or vote over the models of one interleaved output layer */
+static void ensemble_aggregate(Ensemble *this, const float *out, float *result)
+{
+    int j, k, best, n = this->output_count, lanes = this->lanes;
+
+    if (this->aggregate == ENSEMBLE_VOTE)
+    {
+        memset(this->votes, 0, n * sizeof (float));
+        for (k = 0; k < this->models; k++)
+        {
+            if (n == 1)
+            {
+                this->votes[0] += out[k] > 0.5f;
+                continue;
+            }
+            best = 0;
+            for (j = 1; j < n; j++)
+            {
+                best = out[(size_t) j * lanes + k] > out[(size_t) best * lanes + k] ? j : best;
+            }
+            this->votes[best] += 1;
+        }
+        for (j = 0; j < n; j++)
+        {
+            result[j] = this->votes[j] / this->models;
+        }
+        return;
+    }
+    for (j = 0; j < n; j++)
+    {
+        result[j] = 0;
+        for (k = 0; k < this->models; k++)
+        {
+            result[j] += out[(size_t) j * lanes + k];
+        }
+        result[j] /= this->models;
+    }
+}
+
+void ensemble_dispatcher(Ensemble *this, int mthd, int attr, void *msg)
+{
+    switch (mthd)
+    {
+    case(ENSEMBLE_DESTROY): ensemble_destruct(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Ensemble: ::ensemble_dispatcher: Unknown method %d\n", mthd);
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * File: ensemble.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Many networks of one shape scored on the same input in one pass.
+ * EnsembleNew copies the parameters of K models into interleaved
+ * matrices, the model being the fastest varying index. Weight i of neuron
+ * j of model k sits at row j, column i * lanes + k, and the activations
+ * between layers are held the same way, so one dot_lanes call over a row
+ * gives neuron j of every model. A 5-7-5 model is narrower than one vector
+ * register; scored side by side the K models fill the lanes instead.
+ *
+ * lanes is K rounded up to a power of two, or to a multiple of 16 past 16.
+ * The padding models have zero parameters and their outputs are never
+ * read. The models must agree in layer count, layer widths, activation and
+ * slope; the parameters are copied, so the networks may be destroyed once
+ * the ensemble is built.
+ *
+ * Besides the output of each model, a pass gives one aggregate per
+ * output: the mean over the models, or with ENSEMBLE_VOTE the share of the
+ * models whose largest output is that one (whose output is > 0.5 when
+ * there is a single output).
+ */
+#ifndef ENSEMBLE_H
+#define	ENSEMBLE_H
+
+#include "ann.h"
+/* Class Id */
+#define ENSEMBLE            (('E'+'N'+'S'+'E'+'M'+'B'+'L'+'E') << 16)
+/* Methods */
+#define ENSEMBLE_DESTROY    ENSEMBLE + 1
+/* Aggregates */
+#define ENSEMBLE_MEAN       0
+#define ENSEMBLE_VOTE       1
+
+/* One layer of every model */
+typedef struct
+{
+    int count;
+    int inputCnt;
+    int stride;         /* Row pitch in elements, inputCnt * lanes padded to LAYER_ALIGN */
+    int activation;
+    float slope;
+    float *weights;     /* count x stride, interleaved */
+    float *threshold;   /* count x lanes, interleaved */
+} EnsembleLayer;
+
+/* Forward declarations */
+typedef struct _Ensemble Ensemble;
+
+struct _Ensemble
+{
+    int cls;
+    int models;         /* K */
+    int lanes;          /* K padded */
+    int aggregate;      /* ENSEMBLE_MEAN or ENSEMBLE_VOTE */
+    int input_count;
+    int output_count;
+    int layer_count;
+    EnsembleLayer *layers;
+    /* Scratch for one sample, the object is not shared between threads */
+    float *act[2];      /* Interleaved activations, alternate layers */
+    float *votes;       /* output_count */
+    Arena arena;        /* Everything above is carved from it */
+    void (*dispatcher)(Ensemble * this, int mthd, int attr, void * msg);
+};
+
+/* Prototypes */
+Ensemble * ensemble_construct(Ann ** anns, int models, int aggregate);
+void ensemble_dispatcher(Ensemble * this, int mthd, int attr, void * msg);
+void ensemble_forward(Ensemble * this, const float *inputs, int rows, float *outputs,
+                      float *result);
+/* Macros */
+#define EnsembleNew(anns, models, aggregate) ((ensemble_construct)(anns, models, aggregate))
+#define EnsembleDestroy(this)               ((this->dispatcher)(this, ENSEMBLE_DESTROY, 0, NULL))
+#define EnsembleForward(this, inputs, rows, outputs, result) \
+    ((ensemble_forward)(this, inputs, rows, outputs, result))
+
+#endif	/* ENSEMBLE_H */
@@ -0,0 +1,480 @@
+/*
+ * File: kernel.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "activation.h"
+
+/* Prototypes */
+static void gemm_block(int m, int n, int k, const float *a, int lda,
+                       const float *b, int ldb, float *c, int ldc);
+static float scalar_dot(const float *a, const float *b, int n);
+static void scalar_tile(int k, const float *a, int lda,
+                        const float *b, int ldb, float *c, int ldc);
+static void scalar_axpy(float *y, float alpha, const float *x, int n);
+static void scalar_bias_sigmoid(float *x, const float *threshold, int n, float slope);
+static void scalar_bias_fast_sigmoid(float *x, const float *threshold, int n, float slope);
+static void scalar_bias_tanh(float *x, const float *threshold, int n, float slope);
+static void scalar_bias_relu(float *x, const float *threshold, int n, float leak);
+static void scalar_momentum(float *weights, float *change, const float *grad, int n,
+                            float rate, float accel);
+static void scalar_nesterov(float *weights, float *change, const float *grad, int n,
+                            float rate, float accel);
+static void scalar_rmsprop(float *weights, float *square, const float *grad, int n,
+                           float scale, float rate, float decay, float epsilon);
+static void scalar_adam(float *weights, float *mean, float *square, const float *grad, int n,
+                        float scale, float rate, float beta1, float beta2, float epsilon);
+static int32_t scalar_dot_u8(const uint8_t *a, const int8_t *b, int n);
+static void scalar_dot_lanes(const float *a, const float *b, int n, int lanes, float *out);
+static float scalar_dot_sparse(const float *values, const int32_t *columns, int n, const float *x);
+
+/* Globals */
+const KernelOps kernel_scalar = {
+    "scalar", scalar_dot, scalar_tile, scalar_axpy, scalar_bias_sigmoid,
+    scalar_bias_fast_sigmoid, scalar_bias_tanh, scalar_bias_relu, scalar_momentum,
+    scalar_nesterov, scalar_rmsprop, scalar_adam, scalar_dot_u8, scalar_dot_lanes,
+    scalar_dot_sparse
+};
+const KernelOps *kernel_ops = &kernel_scalar;
+
+/* Pick the widest table this CPU runs, once before main() */
+__attribute__((constructor))
+void kernel_init(void)
+{
+    const char *force = getenv("ANN_KERNEL");
+    const KernelOps *tables[4];
+    int i;
+
+    kernel_detect();
+    tables[0] = kernel_avx512;
+    tables[1] = kernel_avx2;
+    tables[2] = kernel_sse2;
+    tables[3] = &kernel_scalar;
+    kernel_ops = &kernel_scalar;
+    for (i = 0; i < 4; i++)
+    {
+        /* Skip tables this CPU can not run */
+        if (tables[i] == NULL)
+        {
+            continue;
+        }
+        if (force == NULL || strcmp(force, tables[i]->name) == 0)
+        {
+            kernel_ops = tables[i];
+            break;
+        }
+    }
+}
+
+float kernel_dot(const float *a, const float *b, int n)
+{
+    return (kernel_ops->dot(a, b, n));
+}
+
+/* y = B * x, B is n x k. The single row case of kernel_gemm_nt, one dot
+ * product per row of B over the whole of k and no zeroing pass. */
+void kernel_gemv(int n, int k, const float *b, int ldb, const float *x, float *y)
+{
+    int j;
+    const KernelOps *ops = kernel_ops;
+
+    for (j = 0; j < n; j++)
+    {
+        y[j] = ops->dot(b + (size_t) j * ldb, x, k);
+    }
+}
+
+/* C = A * B', A is m x k, B is n x k and C is m x n. Both operands are read
+ * along their rows so the weight matrix of a layer can be used as stored. */
+void kernel_gemm_nt(int m, int n, int k, const float *a, int lda,
+                    const float *b, int ldb, float *c, int ldc)
+{
+    int i, i0, j0, k0;
+    int mc, nc, kc;
+
+    for (i = 0; i < m; i++)
+    {
+        memset(c + (size_t) i * ldc, 0, n * sizeof (float));
+    }
+    /* Walk KC wide panels so a block of A and B stays in cache */
+    for (k0 = 0; k0 < k; k0 += KERNEL_KC)
+    {
+        kc = k - k0 < KERNEL_KC ? k - k0 : KERNEL_KC;
+        for (i0 = 0; i0 < m; i0 += KERNEL_MC)
+        {
+            mc = m - i0 < KERNEL_MC ? m - i0 : KERNEL_MC;
+            for (j0 = 0; j0 < n; j0 += KERNEL_NC)
+            {
+                nc = n - j0 < KERNEL_NC ? n - j0 : KERNEL_NC;
+                gemm_block(mc, nc, kc, a + (size_t) i0 * lda + k0, lda,
+                           b + (size_t) j0 * ldb + k0, ldb,
+                           c + (size_t) i0 * ldc + j0, ldc);
+            }
+        }
+    }
+}
+
+/* C += A * B' for one cache block */
+static void gemm_block(int m, int n, int k, const float *a, int lda,
+                       const float *b, int ldb, float *c, int ldc)
+{
+    int i, j;
+    int m4 = m & ~3;
+    int n4 = n & ~3;
+    const KernelOps *ops = kernel_ops;
+
+    for (i = 0; i < m4; i += 4)
+    {
+        for (j = 0; j < n4; j += 4)
+        {
+            ops->tile(k, a + (size_t) i * lda, lda, b + (size_t) j * ldb, ldb,
+                      c + (size_t) i * ldc + j, ldc);
+        }
+    }
+    /* Ragged right hand columns and bottom rows */
+    for (i = 0; i < m; i++)
+    {
+        for (j = i < m4 ? n4 : 0; j < n; j++)
+        {
+            c[(size_t) i * ldc + j] += ops->dot(a + (size_t) i * lda, b + (size_t) j * ldb, k);
+        }
+    }
+}
+
+static float scalar_dot(const float *a, const float *b, int n)
+{
+    int i;
+    float sum = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return (sum);
+}
+
+/* Register blocked 4 x 4 tile, sixteen running sums */
+static void scalar_tile(int k, const float *a, int lda,
+                        const float *b, int ldb, float *c, int ldc)
+{
+    int p, i, j;
+    float acc[4][4] = {{0}};
+    const float *ar[4], *br[4];
+
+    for (i = 0; i < 4; i++)
+    {
+        ar[i] = a + (size_t) i * lda;
+        br[i] = b + (size_t) i * ldb;
+    }
+    for (p = 0; p < k; p++)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            for (j = 0; j < 4; j++)
+            {
+                acc[i][j] += ar[i][p] * br[j][p];
+            }
+        }
+    }
+    for (i = 0; i < 4; i++)
+    {
+        for (j = 0; j < 4; j++)
+        {
+            c[(size_t) i * ldc + j] += acc[i][j];
+        }
+    }
+}
+
+/* C = A * B, A is m x k and B is k x n. The inner loop streams a row of B
+ * into a row of C. Used to carry errors back through a weight matrix. */
+void kernel_gemm_nn(int m, int n, int k, const float *a, int lda,
+                    const float *b, int ldb, float *c, int ldc)
+{
+    int i, p, k0, kc;
+    float *crow;
+
+    for (i = 0; i < m; i++)
+    {
+        memset(c + (size_t) i * ldc, 0, n * sizeof (float));
+    }
+    for (k0 = 0; k0 < k; k0 += KERNEL_KC)
+    {
+        kc = k - k0 < KERNEL_KC ? k - k0 : KERNEL_KC;
+        for (i = 0; i < m; i++)
+        {
+            crow = c + (size_t) i * ldc;
+            for (p = k0; p < k0 + kc; p++)
+            {
+                kernel_ops->axpy(crow, a[(size_t) i * lda + p], b + (size_t) p * ldb, n);
+            }
+        }
+    }
+}
+
+/* C = A' * B, A is k x m and B is k x n. With A the layer errors and B the
+ * layer inputs over a batch this sums the weight gradient of every row. */
+void kernel_gemm_tn(int m, int n, int k, const float *a, int lda,
+                    const float *b, int ldb, float *c, int ldc)
+{
+    int i, p, i0, mc;
+    const float *brow;
+
+    for (i = 0; i < m; i++)
+    {
+        memset(c + (size_t) i * ldc, 0, n * sizeof (float));
+    }
+    /* MC rows of C at a time stay in cache across the whole batch */
+    for (i0 = 0; i0 < m; i0 += KERNEL_MC)
+    {
+        mc = m - i0 < KERNEL_MC ? m - i0 : KERNEL_MC;
+        for (p = 0; p < k; p++)
+        {
+            brow = b + (size_t) p * ldb;
+            for (i = i0; i < i0 + mc; i++)
+            {
+                kernel_ops->axpy(c + (size_t) i * ldc, a[(size_t) p * lda + i], brow, n);
+            }
+        }
+    }
+}
+
+/* c = activation(c - threshold) over each of the m rows */
+void kernel_bias_activation(float *c, int m, int n, int ldc,
+                            const float *threshold, float slope, int activation)
+{
+    int i;
+    float *row;
+
+    for (i = 0; i < m; i++)
+    {
+        row = c + (size_t) i * ldc;
+        switch (activation)
+        {
+        case(ACTIVATION_FAST): kernel_ops->bias_fast_sigmoid(row, threshold, n, slope);
+            break;
+        case(ACTIVATION_TANH): kernel_ops->bias_tanh(row, threshold, n, slope);
+            break;
+        case(ACTIVATION_RELU): kernel_ops->bias_relu(row, threshold, n, 0);
+            break;
+        case(ACTIVATION_LEAKY): kernel_ops->bias_relu(row, threshold, n, ACTIVATION_LEAK);
+            break;
+        default: kernel_ops->bias_sigmoid(row, threshold, n, slope);
+        }
+    }
+}
+
+static void scalar_axpy(float *y, float alpha, const float *x, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+static void scalar_bias_sigmoid(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        x[i] = kernel_sigmoid(slope, x[i] - threshold[i]);
+    }
+}
+
+static void scalar_bias_fast_sigmoid(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        x[i] = activation_apply(ACTIVATION_FAST, slope, x[i] - threshold[i]);
+    }
+}
+
+static void scalar_bias_tanh(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        x[i] = tanhf(-slope * (x[i] - threshold[i]));
+    }
+}
+
+static void scalar_bias_relu(float *x, const float *threshold, int n, float leak)
+{
+    int i;
+    float v;
+
+    for (i = 0; i < n; i++)
+    {
+        v = x[i] - threshold[i];
+        x[i] = v > leak * v ? v : leak * v;
+    }
+}
+
+/* delta *= the activation derivative, taken from active. The switch is
+ * outside the loops so each one is a plain vectorisable loop. */
+void kernel_activation_delta(float *delta, const float *active, int m, int n, int ld,
+                             int activation)
+{
+    int i, j;
+    float *drow;
+    const float *arow;
+
+    for (i = 0; i < m; i++)
+    {
+        drow = delta + (size_t) i * ld;
+        arow = active + (size_t) i * ld;
+        switch (activation)
+        {
+        case(ACTIVATION_TANH):
+            for (j = 0; j < n; j++)
+            {
+                drow[j] *= 1 - arow[j] * arow[j];
+            }
+            break;
+        case(ACTIVATION_RELU):
+            for (j = 0; j < n; j++)
+            {
+                drow[j] = arow[j] > 0 ? drow[j] : 0;
+            }
+            break;
+        case(ACTIVATION_LEAKY):
+            for (j = 0; j < n; j++)
+            {
+                drow[j] *= arow[j] > 0 ? 1.0f : ACTIVATION_LEAK;
+            }
+            break;
+        default:
+            for (j = 0; j < n; j++)
+            {
+                drow[j] *= arow[j] * (1 - arow[j]);
+            }
+        }
+    }
+}
+
+/* sum[j] = sum of column j over the m rows of a */
+void kernel_column_sum(const float *a, int m, int n, int lda, float *sum)
+{
+    int i, j;
+    const float *row;
+
+    memset(sum, 0, n * sizeof (float));
+    for (i = 0; i < m; i++)
+    {
+        row = a + (size_t) i * lda;
+        for (j = 0; j < n; j++)
+        {
+            sum[j] += row[j];
+        }
+    }
+}
+
+/* change = rate * grad + accel * change, weights += change over n elements */
+void kernel_momentum(float *weights, float *change, const float *grad, int n,
+                     float rate, float accel)
+{
+    kernel_ops->momentum(weights, change, grad, n, rate, accel);
+}
+
+static void scalar_momentum(float *weights, float *change, const float *grad, int n,
+                            float rate, float accel)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        change[i] = rate * grad[i] + accel * change[i];
+        weights[i] += change[i];
+    }
+}
+
+static void scalar_nesterov(float *weights, float *change, const float *grad, int n,
+                            float rate, float accel)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        change[i] = rate * grad[i] + accel * change[i];
+        weights[i] += accel * change[i] + rate * grad[i];
+    }
+}
+
+static void scalar_rmsprop(float *weights, float *square, const float *grad, int n,
+                           float scale, float rate, float decay, float epsilon)
+{
+    int i;
+    float g;
+
+    for (i = 0; i < n; i++)
+    {
+        g = scale * grad[i];
+        square[i] = decay * square[i] + (1 - decay) * g * g;
+        weights[i] += rate * g / (sqrtf(square[i]) + epsilon);
+    }
+}
+
+static void scalar_adam(float *weights, float *mean, float *square, const float *grad, int n,
+                        float scale, float rate, float beta1, float beta2, float epsilon)
+{
+    int i;
+    float g;
+
+    for (i = 0; i < n; i++)
+    {
+        g = scale * grad[i];
+        mean[i] = beta1 * mean[i] + (1 - beta1) * g;
+        square[i] = beta2 * square[i] + (1 - beta2) * g * g;
+        weights[i] += rate * mean[i] / (sqrtf(square[i]) + epsilon);
+    }
+}
+
+static int32_t scalar_dot_u8(const uint8_t *a, const int8_t *b, int n)
+{
+    int i;
+    int32_t sum = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return (sum);
+}
+
+static void scalar_dot_lanes(const float *a, const float *b, int n, int lanes, float *out)
+{
+    int i, l;
+
+    for (l = 0; l < lanes; l++)
+    {
+        out[l] = 0;
+    }
+    for (i = 0; i < n; i += lanes)
+    {
+        for (l = 0; l < lanes; l++)
+        {
+            out[l] += a[i + l] * b[i + l];
+        }
+    }
+}
+
+static float scalar_dot_sparse(const float *values, const int32_t *columns, int n, const float *x)
+{
+    int i;
+    float sum = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        sum += values[i] * x[columns[i]];
+    }
+    return (sum);
+}
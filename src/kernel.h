@@ -0,0 +1,124 @@
+/*
+ * File: kernel.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ *
+ * Matrix kernels shared by the batched network paths. Matrices are row
+ * major with an explicit leading dimension (row pitch in elements).
+ *
+ * The inner loops go through a table of vector routines picked once at
+ * start up from the CPUID feature bits (AVX-512, AVX2 + FMA, SSE2 or plain
+ * C). Setting ANN_KERNEL=scalar|sse2|avx2|avx512 in the environment forces
+ * a lower level. Vector results differ from the scalar table only by
+ * rounding: sums are reassociated, so a dot product of n terms may move by
+ * up to n * FLT_EPSILON * sum(|a * b|), and the vector exp() behind the
+ * sigmoid is within 2e-7 relative, keeping activations within
+ * KERNEL_TOLERANCE of the scalar expf() result. make check runs
+ * kernel_check, which holds every table the CPU runs to these bounds. The
+ * activation functions themselves are described in activation.h.
+ *
+ * The 8 bit dot product behind the quantised engine (quant.h) is exact
+ * integer arithmetic and gives the same sum from every table. On AVX-512
+ * CPUs with VNNI the avx512 table uses vpdpbusd for it.
+ *
+ * dot_lanes is the sum behind the ensemble engine (ensemble.h), where the
+ * parameters of several models are interleaved so that lane l of a vector
+ * belongs to model l. It gives every model's dot product from one pass.
+ */
+#ifndef KERNEL_H
+#define	KERNEL_H
+
+#include <math.h>
+#include <stdint.h>
+/* Cache blocking, rows of A, rows of B and the shared dimension */
+#define KERNEL_MC           64
+#define KERNEL_NC           64
+#define KERNEL_KC           256
+/* Largest activation difference between any two kernel tables */
+#define KERNEL_TOLERANCE    1e-6f
+
+/* One set of inner loops for a given instruction set */
+typedef struct _KernelOps KernelOps;
+
+struct _KernelOps
+{
+    const char *name;
+    /* sum of a[i] * b[i] */
+    float (*dot)(const float *a, const float *b, int n);
+    /* 4 x 4 tile of C += A * B' over k */
+    void (*tile)(int k, const float *a, int lda, const float *b, int ldb,
+                 float *c, int ldc);
+    /* y += alpha * x */
+    void (*axpy)(float *y, float alpha, const float *x, int n);
+    /* x = sigmoid(x - threshold) */
+    void (*bias_sigmoid)(float *x, const float *threshold, int n, float slope);
+    /* The same with the cheap exp() of ACTIVATION_FAST */
+    void (*bias_fast_sigmoid)(float *x, const float *threshold, int n, float slope);
+    /* x = tanh(-slope * (x - threshold)) */
+    void (*bias_tanh)(float *x, const float *threshold, int n, float slope);
+    /* x = max(x - threshold, leak * (x - threshold)), leak 0 to 1 */
+    void (*bias_relu)(float *x, const float *threshold, int n, float leak);
+    /* change = rate * grad + accel * change, weights += change */
+    void (*momentum)(float *weights, float *change, const float *grad, int n,
+                     float rate, float accel);
+    /* The same with the step looking ahead along the new change,
+     * weights += accel * change + rate * grad */
+    void (*nesterov)(float *weights, float *change, const float *grad, int n,
+                     float rate, float accel);
+    /* g = scale * grad, square = decay * square + (1 - decay) * g * g,
+     * weights += rate * g / (sqrt(square) + epsilon) */
+    void (*rmsprop)(float *weights, float *square, const float *grad, int n,
+                    float scale, float rate, float decay, float epsilon);
+    /* g = scale * grad, mean and square the moving averages of g and g * g
+     * by beta1 and beta2, weights += rate * mean / (sqrt(square) + epsilon) */
+    void (*adam)(float *weights, float *mean, float *square, const float *grad, int n,
+                 float scale, float rate, float beta1, float beta2, float epsilon);
+    /* sum of a[i] * b[i], a 0 to 127 so no pair of products saturates */
+    int32_t (*dot_u8)(const uint8_t *a, const int8_t *b, int n);
+    /* out[l] = sum of a[i * lanes + l] * b[i * lanes + l], n a multiple of
+     * lanes and lanes a power of two up to 16 or a multiple of 16 */
+    void (*dot_lanes)(const float *a, const float *b, int n, int lanes, float *out);
+    /* sum of values[i] * x[columns[i]], one compressed sparse row */
+    float (*dot_sparse)(const float *values, const int32_t *columns, int n, const float *x);
+};
+
+/* Tables, the vector ones stay NULL unless kernel_detect() finds the CPU
+ * runs them */
+extern const KernelOps kernel_scalar;
+extern const KernelOps *kernel_sse2;
+extern const KernelOps *kernel_avx2;
+extern const KernelOps *kernel_avx512;
+/* Table in use */
+extern const KernelOps *kernel_ops;
+
+/* Prototypes */
+void kernel_init(void);
+void kernel_detect(void);
+float kernel_dot(const float *a, const float *b, int n);
+void kernel_gemv(int n, int k, const float *b, int ldb, const float *x, float *y);
+void kernel_gemm_nt(int m, int n, int k, const float *a, int lda,
+                    const float *b, int ldb, float *c, int ldc);
+void kernel_gemm_nn(int m, int n, int k, const float *a, int lda,
+                    const float *b, int ldb, float *c, int ldc);
+void kernel_gemm_tn(int m, int n, int k, const float *a, int lda,
+                    const float *b, int ldb, float *c, int ldc);
+void kernel_bias_activation(float *c, int m, int n, int ldc,
+                            const float *threshold, float slope, int activation);
+void kernel_activation_delta(float *delta, const float *active, int m, int n, int ld,
+                             int activation);
+void kernel_column_sum(const float *a, int m, int n, int lda, float *sum);
+void kernel_momentum(float *weights, float *change, const float *grad, int n,
+                     float rate, float accel);
+
+/* Logistic activation, limits output range 0 to +1 */
+static inline float kernel_sigmoid(float slope, float x)
+{
+    /* Avoids floating point overflow, written to compile to min and max */
+    x = x > 45 ? 45 : x;
+    x = x < -45 ? -45 : x;
+    return (1 / (1 + expf(slope * x)));
+}
+
+#endif	/* KERNEL_H */
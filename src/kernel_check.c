@@ -0,0 +1,354 @@
+/*
+ * File: kernel_check.c
+ * Program: kernel_check
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Run by make check. Every vector kernel table this CPU runs is held to
+ * the scalar one within the bounds kernel.h documents: a sum of n
+ * products may move by n * FLT_EPSILON * sum(|a * b|), activations and
+ * optimiser steps by KERNEL_TOLERANCE, and ReLU and leaky ReLU not at all.
+ * The ACTIVATION_FAST tier of every table, the scalar one included, is
+ * swept against the exact logistic for ACTIVATION_FAST_ERROR. Sizes cover
+ * the vector tails and more than one KERNEL_KC panel. Prints the worst
+ * difference of each check and fails if any element is out of bounds.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "kernel.h"
+#include "activation.h"
+#include "random.h"
+/* Other */
+#define CHECK_SIZES         9
+#define CHECK_SHAPES        5
+#define CHECK_STEPS         3   /* Optimiser steps from the same state */
+#define CHECK_SWEEP         40.0f   /* Fast sweep over +-CHECK_SWEEP */
+#define CHECK_SWEEP_STEP    (1.0f / 256)
+
+/* Prototypes */
+static int check_dot(const KernelOps *ops);
+static int check_gemm(const KernelOps *ops);
+static int check_activation(const KernelOps *ops, int activation, float lo, float hi,
+                            float bound);
+static int check_fast(const KernelOps *ops);
+static int check_optim(const KernelOps *ops);
+static void step_optim(const KernelOps *ops, int rule, float *w, float *m, float *s,
+                       const float *g, int n);
+static int report(const char *table, const char *what, double worst, long bad);
+static double step_bound(float ref);
+static float * check_alloc(int n, float lo, float hi);
+/* Globals */
+static Random stream;
+static const int sizes[CHECK_SIZES] = {1, 3, 4, 7, 16, 33, 100, 257, 300};
+/* m, n and k of the matrix products */
+static const int shapes[CHECK_SHAPES][3] = {{1, 1, 1}, {5, 7, 3}, {17, 9, 33}, {64, 64, 257},
+                                            {70, 66, 300}};
+static const char *rule_names[4] = {"momentum", "nesterov", "rmsprop", "adam"};
+
+int main(void)
+{
+    const KernelOps *tables[3];
+    int i, failed = 0;
+
+    random_seed(&stream, 1, 0);
+    failed += check_fast(&kernel_scalar);
+    tables[0] = kernel_sse2;
+    tables[1] = kernel_avx2;
+    tables[2] = kernel_avx512;
+    for (i = 0; i < 3; i++)
+    {
+        if (tables[i] == NULL)
+        {
+            continue;
+        }
+        failed += check_dot(tables[i]);
+        failed += check_gemm(tables[i]);
+        failed += check_activation(tables[i], ACTIVATION_LOGISTIC, -60, 60, KERNEL_TOLERANCE);
+        failed += check_activation(tables[i], ACTIVATION_TANH, -30, 30, KERNEL_TOLERANCE);
+        failed += check_activation(tables[i], ACTIVATION_RELU, -10, 10, 0);
+        failed += check_activation(tables[i], ACTIVATION_LEAKY, -10, 10, 0);
+        failed += check_fast(tables[i]);
+        failed += check_optim(tables[i]);
+    }
+    kernel_ops = &kernel_scalar;
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return (failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/* dot against the scalar table at every size */
+static int check_dot(const KernelOps *ops)
+{
+    int i, j, n;
+    long bad = 0;
+    float *a, *b;
+    double d, sum, worst = 0;
+
+    for (i = 0; i < CHECK_SIZES; i++)
+    {
+        n = sizes[i];
+        a = check_alloc(n, -1, 1);
+        b = check_alloc(n, -1, 1);
+        for (sum = 0, j = 0; j < n; j++)
+        {
+            sum += fabs((double) a[j] * b[j]);
+        }
+        d = fabs(ops->dot(a, b, n) - kernel_scalar.dot(a, b, n));
+        worst = d > worst ? d : worst;
+        bad += d > n * FLT_EPSILON * sum;
+        free(a);
+        free(b);
+    }
+    return (report(ops->name, "dot", worst, bad));
+}
+
+/* gemm_nt, gemm_nn and gemm_tn, each element held to the bound of its own
+ * k products */
+static int check_gemm(const KernelOps *ops)
+{
+    int s, form, i, j, p, m, n, k;
+    long bad;
+    float *a, *b, *c, *ref;
+    double d, sum, worst;
+    const char *names[3] = {"gemm_nt", "gemm_nn", "gemm_tn"};
+    int failed = 0;
+
+    for (form = 0; form < 3; form++)
+    {
+        bad = 0;
+        worst = 0;
+        for (s = 0; s < CHECK_SHAPES; s++)
+        {
+            m = shapes[s][0];
+            n = shapes[s][1];
+            k = shapes[s][2];
+            /* nt: A m x k, B n x k. nn: A m x k, B k x n. tn: A k x m, B k x n */
+            a = check_alloc(m * k, -1, 1);
+            b = check_alloc(n * k, -1, 1);
+            c = check_alloc(m * n, 0, 0);
+            ref = check_alloc(m * n, 0, 0);
+            kernel_ops = ops;
+            if (form == 0)
+            {
+                kernel_gemm_nt(m, n, k, a, k, b, k, c, n);
+            }
+            else if (form == 1)
+            {
+                kernel_gemm_nn(m, n, k, a, k, b, n, c, n);
+            }
+            else
+            {
+                kernel_gemm_tn(m, n, k, a, m, b, n, c, n);
+            }
+            kernel_ops = &kernel_scalar;
+            if (form == 0)
+            {
+                kernel_gemm_nt(m, n, k, a, k, b, k, ref, n);
+            }
+            else if (form == 1)
+            {
+                kernel_gemm_nn(m, n, k, a, k, b, n, ref, n);
+            }
+            else
+            {
+                kernel_gemm_tn(m, n, k, a, m, b, n, ref, n);
+            }
+            for (i = 0; i < m; i++)
+            {
+                for (j = 0; j < n; j++)
+                {
+                    for (sum = 0, p = 0; p < k; p++)
+                    {
+                        sum += fabs(form == 0 ? (double) a[i * k + p] * b[j * k + p]
+                                    : form == 1 ? (double) a[i * k + p] * b[p * n + j]
+                                    : (double) a[p * m + i] * b[p * n + j]);
+                    }
+                    d = fabs(c[i * n + j] - ref[i * n + j]);
+                    worst = d > worst ? d : worst;
+                    bad += d > k * FLT_EPSILON * sum;
+                }
+            }
+            free(a);
+            free(b);
+            free(c);
+            free(ref);
+        }
+        failed += report(ops->name, names[form], worst, bad);
+    }
+    return (failed);
+}
+
+/* kernel_bias_activation over inputs lo to hi at three slopes, within
+ * bound of the scalar table */
+static int check_activation(const KernelOps *ops, int activation, float lo, float hi,
+                            float bound)
+{
+    int i, s, r, rows = 8, n = 257;
+    long bad = 0;
+    float *x, *t, *c, *ref;
+    double d, worst = 0;
+    const float slopes[3] = {-3, -1, -0.5f};
+
+    x = check_alloc(rows * n, lo, hi);
+    t = check_alloc(n, -1, 1);
+    c = check_alloc(rows * n, 0, 0);
+    ref = check_alloc(rows * n, 0, 0);
+    for (s = 0; s < 3; s++)
+    {
+        for (r = 0; r < 2; r++)
+        {
+            memcpy(r ? ref : c, x, (size_t) rows * n * sizeof (float));
+            kernel_ops = r ? &kernel_scalar : ops;
+            kernel_bias_activation(r ? ref : c, rows, n, n, t, slopes[s], activation);
+        }
+        for (i = 0; i < rows * n; i++)
+        {
+            d = fabs(c[i] - ref[i]);
+            worst = d > worst ? d : worst;
+            bad += d > bound;
+        }
+    }
+    free(x);
+    free(t);
+    free(c);
+    free(ref);
+    return (report(ops->name, activation_name(activation), worst, bad));
+}
+
+/* ACTIVATION_FAST over +-CHECK_SWEEP against 1 / (1 + exp(slope * x)) in
+ * double, at three slopes */
+static int check_fast(const KernelOps *ops)
+{
+    int i, s, n = (int) (2 * CHECK_SWEEP / CHECK_SWEEP_STEP) + 1;
+    long bad = 0;
+    float *x, *t;
+    double d, worst = 0;
+    const float slopes[3] = {-3, -1, -0.5f};
+
+    x = check_alloc(n, 0, 0);
+    t = check_alloc(n, 0, 0);
+    kernel_ops = ops;
+    for (s = 0; s < 3; s++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            x[i] = -CHECK_SWEEP + i * CHECK_SWEEP_STEP;
+        }
+        kernel_bias_activation(x, 1, n, n, t, slopes[s], ACTIVATION_FAST);
+        for (i = 0; i < n; i++)
+        {
+            d = fabs(x[i] - 1 / (1 + exp((double) slopes[s] * (-CHECK_SWEEP + i * CHECK_SWEEP_STEP))));
+            worst = d > worst ? d : worst;
+            bad += d > ACTIVATION_FAST_ERROR;
+        }
+    }
+    kernel_ops = &kernel_scalar;
+    free(x);
+    free(t);
+    return (report(ops->name, activation_name(ACTIVATION_FAST), worst, bad));
+}
+
+/* Every update rule, a few steps from the same state */
+static int check_optim(const KernelOps *ops)
+{
+    int i, j, rule, n, failed = 0;
+    long bad;
+    float *g, *w[2], *m[2], *s[2];
+    double d, worst;
+
+    for (rule = 0; rule < 4; rule++)
+    {
+        bad = 0;
+        worst = 0;
+        for (i = 0; i < CHECK_SIZES; i++)
+        {
+            n = sizes[i];
+            g = check_alloc(n, -1, 1);
+            w[0] = check_alloc(n, -1, 1);
+            m[0] = check_alloc(n, -0.1f, 0.1f);
+            s[0] = check_alloc(n, 0.01f, 1);
+            w[1] = check_alloc(n, 0, 0);
+            m[1] = check_alloc(n, 0, 0);
+            s[1] = check_alloc(n, 0, 0);
+            memcpy(w[1], w[0], n * sizeof (float));
+            memcpy(m[1], m[0], n * sizeof (float));
+            memcpy(s[1], s[0], n * sizeof (float));
+            step_optim(ops, rule, w[0], m[0], s[0], g, n);
+            step_optim(&kernel_scalar, rule, w[1], m[1], s[1], g, n);
+            for (j = 0; j < n; j++)
+            {
+                d = fabs(w[0][j] - w[1][j]);
+                d = fabs(m[0][j] - m[1][j]) > d ? fabs(m[0][j] - m[1][j]) : d;
+                d = fabs(s[0][j] - s[1][j]) > d ? fabs(s[0][j] - s[1][j]) : d;
+                worst = d > worst ? d : worst;
+                bad += fabs(w[0][j] - w[1][j]) > step_bound(w[1][j])
+                       || fabs(m[0][j] - m[1][j]) > step_bound(m[1][j])
+                       || fabs(s[0][j] - s[1][j]) > step_bound(s[1][j]);
+            }
+            free(g);
+            free(w[0]);
+            free(m[0]);
+            free(s[0]);
+            free(w[1]);
+            free(m[1]);
+            free(s[1]);
+        }
+        failed += report(ops->name, rule_names[rule], worst, bad);
+    }
+    return (failed);
+}
+
+/* CHECK_STEPS steps of rule, with the rates ann_train would pass */
+static void step_optim(const KernelOps *ops, int rule, float *w, float *m, float *s,
+                       const float *g, int n)
+{
+    int i;
+
+    for (i = 0; i < CHECK_STEPS; i++)
+    {
+        switch (rule)
+        {
+        case(0): ops->momentum(w, m, g, n, 0.02f / 32, 0.3f);
+            break;
+        case(1): ops->nesterov(w, m, g, n, 0.02f / 32, 0.3f);
+            break;
+        case(2): ops->rmsprop(w, s, g, n, 1.0f / 32, 0.001f, 0.9f, 1e-8f);
+            break;
+        default: ops->adam(w, m, s, g, n, 1.0f / 32, 0.001f, 0.9f, 0.999f, 1e-8f);
+        }
+    }
+}
+
+/* KERNEL_TOLERANCE, relative once a value passes 1 */
+static double step_bound(float ref)
+{
+    return (KERNEL_TOLERANCE * (fabs(ref) > 1 ? fabs(ref) : 1));
+}
+
+/* One line per check, 1 if it failed */
+static int report(const char *table, const char *what, double worst, long bad)
+{
+    printf("%-7s %-9s worst %.3g%s\n", table, what, worst, bad ? " OUT OF BOUNDS" : "");
+    if (bad)
+    {
+        printf("%-7s %-9s %ld values out of bounds\n", table, what, bad);
+    }
+    return (bad != 0);
+}
+
+/* n values uniform in lo to hi */
+static float * check_alloc(int n, float lo, float hi)
+{
+    float *x = malloc(n * sizeof (float));
+
+    if (x == NULL)
+    {
+        printf("kernel_check: Memory allocation failed");
+        exit(1);
+    }
+    random_fill(&stream, x, n, lo, hi);
+    return (x);
+}
@@ -0,0 +1,1389 @@
+/*
+ * File: kernel_x86.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ *
+ * SSE2, AVX2 + FMA and AVX-512 versions of the kernel table. Each routine
+ * carries its own target attribute so the file builds with the default
+ * compiler flags and the choice is made at run time by kernel_detect().
+ */
+#include "activation.h"
+
+/* Globals */
+const KernelOps *kernel_sse2;
+const KernelOps *kernel_avx2;
+const KernelOps *kernel_avx512;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define SSE2                __attribute__((target("sse2")))
+#define AVX2                __attribute__((target("avx2,fma")))
+#define AVX512              __attribute__((target("avx512f")))
+#define AVX512VNNI          __attribute__((target("avx512f,avx512bw,avx512vnni")))
+/* exp() range reduction and Cephes polynomial */
+#define EXP_LIMIT           87.0f
+#define EXP_LOG2E           1.44269504088896341f
+#define EXP_C1              0.693359375f
+#define EXP_C2              -2.12194440e-4f
+#define EXP_P0              1.9875691500e-4f
+#define EXP_P1              1.3981999507e-3f
+#define EXP_P2              8.3334519073e-3f
+#define EXP_P3              4.1665795894e-2f
+#define EXP_P4              1.6666665459e-1f
+#define EXP_P5              5.0000001201e-1f
+/* Input clamp of kernel_sigmoid() */
+#define SIGMOID_LIMIT       45.0f
+
+/* Prototypes */
+static float sse2_dot(const float *a, const float *b, int n);
+static void sse2_tile(int k, const float *a, int lda, const float *b, int ldb,
+                      float *c, int ldc);
+static void sse2_axpy(float *y, float alpha, const float *x, int n);
+static void sse2_bias_sigmoid(float *x, const float *threshold, int n, float slope);
+static void sse2_bias_fast_sigmoid(float *x, const float *threshold, int n, float slope);
+static void sse2_bias_tanh(float *x, const float *threshold, int n, float slope);
+static void sse2_bias_relu(float *x, const float *threshold, int n, float leak);
+static void sse2_momentum(float *weights, float *change, const float *grad, int n,
+                          float rate, float accel);
+static void sse2_nesterov(float *weights, float *change, const float *grad, int n,
+                          float rate, float accel);
+static void sse2_rmsprop(float *weights, float *square, const float *grad, int n,
+                         float scale, float rate, float decay, float epsilon);
+static void sse2_adam(float *weights, float *mean, float *square, const float *grad, int n,
+                      float scale, float rate, float beta1, float beta2, float epsilon);
+static int32_t sse2_dot_u8(const uint8_t *a, const int8_t *b, int n);
+static void sse2_dot_lanes(const float *a, const float *b, int n, int lanes, float *out);
+static float sse2_dot_sparse(const float *values, const int32_t *columns, int n, const float *x);
+static float avx2_dot(const float *a, const float *b, int n);
+static void avx2_tile(int k, const float *a, int lda, const float *b, int ldb,
+                      float *c, int ldc);
+static void avx2_axpy(float *y, float alpha, const float *x, int n);
+static void avx2_bias_sigmoid(float *x, const float *threshold, int n, float slope);
+static void avx2_bias_fast_sigmoid(float *x, const float *threshold, int n, float slope);
+static void avx2_bias_tanh(float *x, const float *threshold, int n, float slope);
+static void avx2_bias_relu(float *x, const float *threshold, int n, float leak);
+static void avx2_momentum(float *weights, float *change, const float *grad, int n,
+                          float rate, float accel);
+static void avx2_nesterov(float *weights, float *change, const float *grad, int n,
+                          float rate, float accel);
+static void avx2_rmsprop(float *weights, float *square, const float *grad, int n,
+                         float scale, float rate, float decay, float epsilon);
+static void avx2_adam(float *weights, float *mean, float *square, const float *grad, int n,
+                      float scale, float rate, float beta1, float beta2, float epsilon);
+static int32_t avx2_dot_u8(const uint8_t *a, const int8_t *b, int n);
+static void avx2_dot_lanes(const float *a, const float *b, int n, int lanes, float *out);
+static float avx2_dot_sparse(const float *values, const int32_t *columns, int n, const float *x);
+static float avx512_dot(const float *a, const float *b, int n);
+static void avx512_tile(int k, const float *a, int lda, const float *b, int ldb,
+                        float *c, int ldc);
+static void avx512_axpy(float *y, float alpha, const float *x, int n);
+static void avx512_bias_sigmoid(float *x, const float *threshold, int n, float slope);
+static void avx512_bias_fast_sigmoid(float *x, const float *threshold, int n, float slope);
+static void avx512_bias_tanh(float *x, const float *threshold, int n, float slope);
+static void avx512_bias_relu(float *x, const float *threshold, int n, float leak);
+static void avx512_momentum(float *weights, float *change, const float *grad, int n,
+                            float rate, float accel);
+static void avx512_nesterov(float *weights, float *change, const float *grad, int n,
+                            float rate, float accel);
+static void avx512_rmsprop(float *weights, float *square, const float *grad, int n,
+                           float scale, float rate, float decay, float epsilon);
+static void avx512_adam(float *weights, float *mean, float *square, const float *grad, int n,
+                        float scale, float rate, float beta1, float beta2, float epsilon);
+static int32_t avx512_vnni_dot_u8(const uint8_t *a, const int8_t *b, int n);
+static void avx512_dot_lanes(const float *a, const float *b, int n, int lanes, float *out);
+static float avx512_dot_sparse(const float *values, const int32_t *columns, int n, const float *x);
+
+static const KernelOps sse2_ops = {
+    "sse2", sse2_dot, sse2_tile, sse2_axpy, sse2_bias_sigmoid,
+    sse2_bias_fast_sigmoid, sse2_bias_tanh, sse2_bias_relu, sse2_momentum,
+    sse2_nesterov, sse2_rmsprop, sse2_adam, sse2_dot_u8, sse2_dot_lanes,
+    sse2_dot_sparse
+};
+static const KernelOps avx2_ops = {
+    "avx2", avx2_dot, avx2_tile, avx2_axpy, avx2_bias_sigmoid,
+    avx2_bias_fast_sigmoid, avx2_bias_tanh, avx2_bias_relu, avx2_momentum,
+    avx2_nesterov, avx2_rmsprop, avx2_adam, avx2_dot_u8, avx2_dot_lanes,
+    avx2_dot_sparse
+};
+static const KernelOps avx512_ops = {
+    "avx512", avx512_dot, avx512_tile, avx512_axpy, avx512_bias_sigmoid,
+    avx512_bias_fast_sigmoid, avx512_bias_tanh, avx512_bias_relu, avx512_momentum,
+    avx512_nesterov, avx512_rmsprop, avx512_adam, avx2_dot_u8, avx512_dot_lanes,
+    avx512_dot_sparse
+};
+/* The same with the 8 bit dot product on VNNI, AVX-512F alone has no byte
+ * multiply so the plain table borrows the AVX2 one */
+static const KernelOps avx512_vnni_ops = {
+    "avx512", avx512_dot, avx512_tile, avx512_axpy, avx512_bias_sigmoid,
+    avx512_bias_fast_sigmoid, avx512_bias_tanh, avx512_bias_relu, avx512_momentum,
+    avx512_nesterov, avx512_rmsprop, avx512_adam, avx512_vnni_dot_u8, avx512_dot_lanes,
+    avx512_dot_sparse
+};
+
+/* Publish the tables this CPU and operating system can run */
+void kernel_detect(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        kernel_sse2 = &sse2_ops;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        kernel_avx2 = &avx2_ops;
+    }
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        kernel_avx512 = &avx512_ops;
+        if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vnni"))
+        {
+            kernel_avx512 = &avx512_vnni_ops;
+        }
+    }
+}
+
+/*
+ * SSE2, four lanes
+ */
+SSE2 static inline float sse2_hsum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return (_mm_cvtss_f32(v));
+}
+
+SSE2 static inline __m128 sse2_exp(__m128 x)
+{
+    __m128i n;
+    __m128 fx, y, z;
+
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-EXP_LIMIT)), _mm_set1_ps(EXP_LIMIT));
+    /* x = n * ln2 + r, n rounded to nearest */
+    n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(EXP_LOG2E)));
+    fx = _mm_cvtepi32_ps(n);
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(EXP_C1)));
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(EXP_C2)));
+    z = _mm_mul_ps(x, x);
+    y = _mm_set1_ps(EXP_P0);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P1));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P2));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P3));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P4));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P5));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), _mm_set1_ps(1.0f));
+    /* Scale by 2^n built straight into the exponent bits */
+    n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+    return (_mm_mul_ps(y, _mm_castsi128_ps(n)));
+}
+
+/* Cubic exp() of ACTIVATION_FAST */
+SSE2 static inline __m128 sse2_fast_exp(__m128 x)
+{
+    __m128i n;
+    __m128 t, y;
+
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-FAST_EXP_LIMIT)), _mm_set1_ps(FAST_EXP_LIMIT));
+    t = _mm_mul_ps(x, _mm_set1_ps(FAST_EXP_LOG2E));
+    n = _mm_cvtps_epi32(t);
+    t = _mm_sub_ps(t, _mm_cvtepi32_ps(n));
+    y = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(FAST_EXP_C3), t), _mm_set1_ps(FAST_EXP_C2));
+    y = _mm_add_ps(_mm_mul_ps(y, t), _mm_set1_ps(FAST_EXP_C1));
+    y = _mm_add_ps(_mm_mul_ps(y, t), _mm_set1_ps(FAST_EXP_C0));
+    n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+    return (_mm_mul_ps(y, _mm_castsi128_ps(n)));
+}
+
+/* 1 / d from the 12 bit estimate and one Newton step */
+SSE2 static inline __m128 sse2_recip(__m128 d)
+{
+    __m128 r = _mm_rcp_ps(d);
+
+    return (_mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(d, r))));
+}
+
+SSE2 static float sse2_dot(const float *a, const float *b, int n)
+{
+    int i;
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+    float sum;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    sum = sse2_hsum(_mm_add_ps(s0, s1));
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return (sum);
+}
+
+/* Two passes of a 2 x 4 block keep the eight sums in registers */
+SSE2 static void sse2_tile(int k, const float *a, int lda, const float *b, int ldb,
+                           float *c, int ldc)
+{
+    int i, j, p, kv = k & ~3;
+    __m128 acc[2][4], av[2], bv;
+    const float *ar[2];
+    float tail;
+
+    for (i = 0; i < 4; i += 2)
+    {
+        ar[0] = a + (size_t) i * lda;
+        ar[1] = a + (size_t) (i + 1) * lda;
+        for (j = 0; j < 4; j++)
+        {
+            acc[0][j] = _mm_setzero_ps();
+            acc[1][j] = _mm_setzero_ps();
+        }
+        for (p = 0; p < kv; p += 4)
+        {
+            av[0] = _mm_loadu_ps(ar[0] + p);
+            av[1] = _mm_loadu_ps(ar[1] + p);
+            for (j = 0; j < 4; j++)
+            {
+                bv = _mm_loadu_ps(b + (size_t) j * ldb + p);
+                acc[0][j] = _mm_add_ps(acc[0][j], _mm_mul_ps(av[0], bv));
+                acc[1][j] = _mm_add_ps(acc[1][j], _mm_mul_ps(av[1], bv));
+            }
+        }
+        for (j = 0; j < 4; j++)
+        {
+            tail = 0;
+            for (p = kv; p < k; p++)
+            {
+                tail += ar[0][p] * b[(size_t) j * ldb + p];
+            }
+            c[(size_t) i * ldc + j] += sse2_hsum(acc[0][j]) + tail;
+            tail = 0;
+            for (p = kv; p < k; p++)
+            {
+                tail += ar[1][p] * b[(size_t) j * ldb + p];
+            }
+            c[(size_t) (i + 1) * ldc + j] += sse2_hsum(acc[1][j]) + tail;
+        }
+    }
+}
+
+SSE2 static void sse2_axpy(float *y, float alpha, const float *x, int n)
+{
+    int i;
+    __m128 av = _mm_set1_ps(alpha);
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(av, _mm_loadu_ps(x + i))));
+    }
+    for (; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+SSE2 static void sse2_bias_sigmoid(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+    __m128 v;
+    __m128 one = _mm_set1_ps(1.0f);
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        v = _mm_sub_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(threshold + i));
+        v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-SIGMOID_LIMIT)), _mm_set1_ps(SIGMOID_LIMIT));
+        v = sse2_exp(_mm_mul_ps(v, _mm_set1_ps(slope)));
+        _mm_storeu_ps(x + i, _mm_div_ps(one, _mm_add_ps(one, v)));
+    }
+    for (; i < n; i++)
+    {
+        x[i] = kernel_sigmoid(slope, x[i] - threshold[i]);
+    }
+}
+
+SSE2 static void sse2_bias_fast_sigmoid(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+    __m128 v;
+    __m128 one = _mm_set1_ps(1.0f);
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        v = _mm_sub_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(threshold + i));
+        v = sse2_fast_exp(_mm_mul_ps(v, _mm_set1_ps(slope)));
+        _mm_storeu_ps(x + i, sse2_recip(_mm_add_ps(one, v)));
+    }
+    for (; i < n; i++)
+    {
+        x[i] = activation_apply(ACTIVATION_FAST, slope, x[i] - threshold[i]);
+    }
+}
+
+SSE2 static void sse2_bias_tanh(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+    __m128 v;
+    __m128 one = _mm_set1_ps(1.0f);
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        v = _mm_sub_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(threshold + i));
+        v = sse2_exp(_mm_mul_ps(v, _mm_set1_ps(-2 * slope)));
+        v = _mm_div_ps(_mm_set1_ps(2.0f), _mm_add_ps(one, v));
+        _mm_storeu_ps(x + i, _mm_sub_ps(one, v));
+    }
+    for (; i < n; i++)
+    {
+        x[i] = tanhf(-slope * (x[i] - threshold[i]));
+    }
+}
+
+SSE2 static void sse2_bias_relu(float *x, const float *threshold, int n, float leak)
+{
+    int i;
+    float v;
+    __m128 u;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        u = _mm_sub_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(threshold + i));
+        _mm_storeu_ps(x + i, _mm_max_ps(u, _mm_mul_ps(u, _mm_set1_ps(leak))));
+    }
+    for (; i < n; i++)
+    {
+        v = x[i] - threshold[i];
+        x[i] = v > leak * v ? v : leak * v;
+    }
+}
+
+SSE2 static void sse2_momentum(float *weights, float *change, const float *grad, int n,
+                               float rate, float accel)
+{
+    int i;
+    __m128 rv = _mm_set1_ps(rate);
+    __m128 cv = _mm_set1_ps(accel);
+    __m128 d;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        d = _mm_add_ps(_mm_mul_ps(rv, _mm_loadu_ps(grad + i)),
+                       _mm_mul_ps(cv, _mm_loadu_ps(change + i)));
+        _mm_storeu_ps(change + i, d);
+        _mm_storeu_ps(weights + i, _mm_add_ps(_mm_loadu_ps(weights + i), d));
+    }
+    for (; i < n; i++)
+    {
+        change[i] = rate * grad[i] + accel * change[i];
+        weights[i] += change[i];
+    }
+}
+
+SSE2 static void sse2_nesterov(float *weights, float *change, const float *grad, int n,
+                               float rate, float accel)
+{
+    int i;
+    __m128 rv = _mm_set1_ps(rate);
+    __m128 cv = _mm_set1_ps(accel);
+    __m128 g, d;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        g = _mm_mul_ps(rv, _mm_loadu_ps(grad + i));
+        d = _mm_add_ps(g, _mm_mul_ps(cv, _mm_loadu_ps(change + i)));
+        _mm_storeu_ps(change + i, d);
+        _mm_storeu_ps(weights + i, _mm_add_ps(_mm_loadu_ps(weights + i),
+                                              _mm_add_ps(_mm_mul_ps(cv, d), g)));
+    }
+    for (; i < n; i++)
+    {
+        change[i] = rate * grad[i] + accel * change[i];
+        weights[i] += accel * change[i] + rate * grad[i];
+    }
+}
+
+SSE2 static void sse2_rmsprop(float *weights, float *square, const float *grad, int n,
+                              float scale, float rate, float decay, float epsilon)
+{
+    int i;
+    float gs;
+    __m128 sv = _mm_set1_ps(scale);
+    __m128 rv = _mm_set1_ps(rate);
+    __m128 dv = _mm_set1_ps(decay);
+    __m128 ev = _mm_set1_ps(epsilon);
+    __m128 kv = _mm_set1_ps(1 - decay);
+    __m128 g, q;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        g = _mm_mul_ps(sv, _mm_loadu_ps(grad + i));
+        q = _mm_add_ps(_mm_mul_ps(dv, _mm_loadu_ps(square + i)), _mm_mul_ps(kv, _mm_mul_ps(g, g)));
+        _mm_storeu_ps(square + i, q);
+        _mm_storeu_ps(weights + i, _mm_add_ps(_mm_loadu_ps(weights + i),
+                                              _mm_div_ps(_mm_mul_ps(rv, g),
+                                                         _mm_add_ps(_mm_sqrt_ps(q), ev))));
+    }
+    for (; i < n; i++)
+    {
+        gs = scale * grad[i];
+        square[i] = decay * square[i] + (1 - decay) * gs * gs;
+        weights[i] += rate * gs / (sqrtf(square[i]) + epsilon);
+    }
+}
+
+SSE2 static void sse2_adam(float *weights, float *mean, float *square, const float *grad, int n,
+                           float scale, float rate, float beta1, float beta2, float epsilon)
+{
+    int i;
+    float gs;
+    __m128 sv = _mm_set1_ps(scale);
+    __m128 rv = _mm_set1_ps(rate);
+    __m128 b1 = _mm_set1_ps(beta1);
+    __m128 b2 = _mm_set1_ps(beta2);
+    __m128 k1 = _mm_set1_ps(1 - beta1);
+    __m128 k2 = _mm_set1_ps(1 - beta2);
+    __m128 ev = _mm_set1_ps(epsilon);
+    __m128 g, m, q;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        g = _mm_mul_ps(sv, _mm_loadu_ps(grad + i));
+        m = _mm_add_ps(_mm_mul_ps(b1, _mm_loadu_ps(mean + i)), _mm_mul_ps(k1, g));
+        q = _mm_add_ps(_mm_mul_ps(b2, _mm_loadu_ps(square + i)), _mm_mul_ps(k2, _mm_mul_ps(g, g)));
+        _mm_storeu_ps(mean + i, m);
+        _mm_storeu_ps(square + i, q);
+        _mm_storeu_ps(weights + i, _mm_add_ps(_mm_loadu_ps(weights + i),
+                                              _mm_div_ps(_mm_mul_ps(rv, m),
+                                                         _mm_add_ps(_mm_sqrt_ps(q), ev))));
+    }
+    for (; i < n; i++)
+    {
+        gs = scale * grad[i];
+        mean[i] = beta1 * mean[i] + (1 - beta1) * gs;
+        square[i] = beta2 * square[i] + (1 - beta2) * gs * gs;
+        weights[i] += rate * mean[i] / (sqrtf(square[i]) + epsilon);
+    }
+}
+
+/* Bytes widened to 16 bits, pmaddwd forms the pair sums */
+SSE2 static int32_t sse2_dot_u8(const uint8_t *a, const int8_t *b, int n)
+{
+    int i;
+    int32_t sum;
+    __m128i s = _mm_setzero_si128();
+    __m128i zero = _mm_setzero_si128();
+    __m128i av, bv, sign;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        av = _mm_loadu_si128((const __m128i *) (a + i));
+        bv = _mm_loadu_si128((const __m128i *) (b + i));
+        sign = _mm_cmpgt_epi8(zero, bv);
+        s = _mm_add_epi32(s, _mm_madd_epi16(_mm_unpacklo_epi8(av, zero), _mm_unpacklo_epi8(bv, sign)));
+        s = _mm_add_epi32(s, _mm_madd_epi16(_mm_unpackhi_epi8(av, zero), _mm_unpackhi_epi8(bv, sign)));
+    }
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    sum = _mm_cvtsi128_si32(s);
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return (sum);
+}
+
+/* The four sums of v added down to lanes of 1, 2 or 4 */
+SSE2 static inline void sse2_fold(__m128 v, int lanes, float *out)
+{
+    if (lanes == 4)
+    {
+        _mm_storeu_ps(out, v);
+        return;
+    }
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    if (lanes == 2)
+    {
+        _mm_storel_pi((__m64 *) out, v);
+        return;
+    }
+    _mm_store_ss(out, _mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+
+/* Lanes a multiple of four run as blocks of four models, fewer fold the
+ * four sums down */
+SSE2 static void sse2_dot_lanes(const float *a, const float *b, int n, int lanes, float *out)
+{
+    int i, o;
+    __m128 s0, s1;
+
+    if (lanes % 4 == 0)
+    {
+        for (o = 0; o < lanes; o += 4)
+        {
+            s0 = _mm_setzero_ps();
+            for (i = o; i < n; i += lanes)
+            {
+                s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            }
+            _mm_storeu_ps(out + o, s0);
+        }
+        return;
+    }
+    s0 = _mm_setzero_ps();
+    s1 = _mm_setzero_ps();
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    sse2_fold(_mm_add_ps(s0, s1), lanes, out);
+    for (; i < n; i++)
+    {
+        out[i % lanes] += a[i] * b[i];
+    }
+}
+
+/* No gather before AVX2, the lanes are loaded one by one */
+SSE2 static float sse2_dot_sparse(const float *values, const int32_t *columns, int n, const float *x)
+{
+    int i;
+    __m128 s0 = _mm_setzero_ps();
+    float sum;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(values + i),
+                                       _mm_setr_ps(x[columns[i]], x[columns[i + 1]],
+                                                   x[columns[i + 2]], x[columns[i + 3]])));
+    }
+    sum = sse2_hsum(s0);
+    for (; i < n; i++)
+    {
+        sum += values[i] * x[columns[i]];
+    }
+    return (sum);
+}
+
+/*
+ * AVX2 + FMA, eight lanes
+ */
+AVX2 static inline float avx2_hsum(__m256 v)
+{
+    __m128 h = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+
+    h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+    h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));
+    return (_mm_cvtss_f32(h));
+}
+
+AVX2 static inline __m256 avx2_exp(__m256 x)
+{
+    __m256i n;
+    __m256 fx, y, z;
+
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-EXP_LIMIT)), _mm256_set1_ps(EXP_LIMIT));
+    n = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(EXP_LOG2E)));
+    fx = _mm256_cvtepi32_ps(n);
+    x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(EXP_C1), x);
+    x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(EXP_C2), x);
+    z = _mm256_mul_ps(x, x);
+    y = _mm256_set1_ps(EXP_P0);
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P1));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P2));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P3));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P4));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P5));
+    y = _mm256_add_ps(_mm256_fmadd_ps(y, z, x), _mm256_set1_ps(1.0f));
+    n = _mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23);
+    return (_mm256_mul_ps(y, _mm256_castsi256_ps(n)));
+}
+
+/* Cubic exp() of ACTIVATION_FAST */
+AVX2 static inline __m256 avx2_fast_exp(__m256 x)
+{
+    __m256i n;
+    __m256 t, y;
+
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-FAST_EXP_LIMIT)),
+                      _mm256_set1_ps(FAST_EXP_LIMIT));
+    t = _mm256_mul_ps(x, _mm256_set1_ps(FAST_EXP_LOG2E));
+    n = _mm256_cvtps_epi32(t);
+    t = _mm256_sub_ps(t, _mm256_cvtepi32_ps(n));
+    y = _mm256_fmadd_ps(_mm256_set1_ps(FAST_EXP_C3), t, _mm256_set1_ps(FAST_EXP_C2));
+    y = _mm256_fmadd_ps(y, t, _mm256_set1_ps(FAST_EXP_C1));
+    y = _mm256_fmadd_ps(y, t, _mm256_set1_ps(FAST_EXP_C0));
+    n = _mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23);
+    return (_mm256_mul_ps(y, _mm256_castsi256_ps(n)));
+}
+
+/* 1 / d from the 12 bit estimate and one Newton step */
+AVX2 static inline __m256 avx2_recip(__m256 d)
+{
+    __m256 r = _mm256_rcp_ps(d);
+
+    return (_mm256_mul_ps(r, _mm256_fnmadd_ps(d, r, _mm256_set1_ps(2.0f))));
+}
+
+AVX2 static float avx2_dot(const float *a, const float *b, int n)
+{
+    int i;
+    __m256 s0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps();
+    __m256 s3 = _mm256_setzero_ps();
+    float sum;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+        s2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), s2);
+        s3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), s3);
+    }
+    for (; i + 8 <= n; i += 8)
+    {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+    }
+    sum = avx2_hsum(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return (sum);
+}
+
+/* Two passes of a 2 x 4 block, eight accumulators out of sixteen registers */
+AVX2 static void avx2_tile(int k, const float *a, int lda, const float *b, int ldb,
+                           float *c, int ldc)
+{
+    int i, j, p, kv = k & ~7;
+    __m256 acc[2][4], av[2], bv;
+    const float *ar[2];
+    float tail;
+
+    for (i = 0; i < 4; i += 2)
+    {
+        ar[0] = a + (size_t) i * lda;
+        ar[1] = a + (size_t) (i + 1) * lda;
+        for (j = 0; j < 4; j++)
+        {
+            acc[0][j] = _mm256_setzero_ps();
+            acc[1][j] = _mm256_setzero_ps();
+        }
+        for (p = 0; p < kv; p += 8)
+        {
+            av[0] = _mm256_loadu_ps(ar[0] + p);
+            av[1] = _mm256_loadu_ps(ar[1] + p);
+            for (j = 0; j < 4; j++)
+            {
+                bv = _mm256_loadu_ps(b + (size_t) j * ldb + p);
+                acc[0][j] = _mm256_fmadd_ps(av[0], bv, acc[0][j]);
+                acc[1][j] = _mm256_fmadd_ps(av[1], bv, acc[1][j]);
+            }
+        }
+        for (j = 0; j < 4; j++)
+        {
+            tail = 0;
+            for (p = kv; p < k; p++)
+            {
+                tail += ar[0][p] * b[(size_t) j * ldb + p];
+            }
+            c[(size_t) i * ldc + j] += avx2_hsum(acc[0][j]) + tail;
+            tail = 0;
+            for (p = kv; p < k; p++)
+            {
+                tail += ar[1][p] * b[(size_t) j * ldb + p];
+            }
+            c[(size_t) (i + 1) * ldc + j] += avx2_hsum(acc[1][j]) + tail;
+        }
+    }
+}
+
+AVX2 static void avx2_axpy(float *y, float alpha, const float *x, int n)
+{
+    int i;
+    __m256 av = _mm256_set1_ps(alpha);
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(av, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for (; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+AVX2 static void avx2_bias_sigmoid(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+    __m256 v;
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        v = _mm256_sub_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(threshold + i));
+        v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-SIGMOID_LIMIT)),
+                          _mm256_set1_ps(SIGMOID_LIMIT));
+        v = avx2_exp(_mm256_mul_ps(v, _mm256_set1_ps(slope)));
+        _mm256_storeu_ps(x + i, _mm256_div_ps(one, _mm256_add_ps(one, v)));
+    }
+    for (; i < n; i++)
+    {
+        x[i] = kernel_sigmoid(slope, x[i] - threshold[i]);
+    }
+}
+
+AVX2 static void avx2_bias_fast_sigmoid(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+    __m256 v;
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        v = _mm256_sub_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(threshold + i));
+        v = avx2_fast_exp(_mm256_mul_ps(v, _mm256_set1_ps(slope)));
+        _mm256_storeu_ps(x + i, avx2_recip(_mm256_add_ps(one, v)));
+    }
+    for (; i < n; i++)
+    {
+        x[i] = activation_apply(ACTIVATION_FAST, slope, x[i] - threshold[i]);
+    }
+}
+
+AVX2 static void avx2_bias_tanh(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+    __m256 v;
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        v = _mm256_sub_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(threshold + i));
+        v = avx2_exp(_mm256_mul_ps(v, _mm256_set1_ps(-2 * slope)));
+        v = _mm256_div_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(one, v));
+        _mm256_storeu_ps(x + i, _mm256_sub_ps(one, v));
+    }
+    for (; i < n; i++)
+    {
+        x[i] = tanhf(-slope * (x[i] - threshold[i]));
+    }
+}
+
+AVX2 static void avx2_bias_relu(float *x, const float *threshold, int n, float leak)
+{
+    int i;
+    float v;
+    __m256 u;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        u = _mm256_sub_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(threshold + i));
+        _mm256_storeu_ps(x + i, _mm256_max_ps(u, _mm256_mul_ps(u, _mm256_set1_ps(leak))));
+    }
+    for (; i < n; i++)
+    {
+        v = x[i] - threshold[i];
+        x[i] = v > leak * v ? v : leak * v;
+    }
+}
+
+AVX2 static void avx2_momentum(float *weights, float *change, const float *grad, int n,
+                               float rate, float accel)
+{
+    int i;
+    __m256 rv = _mm256_set1_ps(rate);
+    __m256 cv = _mm256_set1_ps(accel);
+    __m256 d;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        d = _mm256_fmadd_ps(rv, _mm256_loadu_ps(grad + i),
+                            _mm256_mul_ps(cv, _mm256_loadu_ps(change + i)));
+        _mm256_storeu_ps(change + i, d);
+        _mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i), d));
+    }
+    for (; i < n; i++)
+    {
+        change[i] = rate * grad[i] + accel * change[i];
+        weights[i] += change[i];
+    }
+}
+
+AVX2 static void avx2_nesterov(float *weights, float *change, const float *grad, int n,
+                               float rate, float accel)
+{
+    int i;
+    __m256 rv = _mm256_set1_ps(rate);
+    __m256 cv = _mm256_set1_ps(accel);
+    __m256 g, d;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        g = _mm256_mul_ps(rv, _mm256_loadu_ps(grad + i));
+        d = _mm256_fmadd_ps(cv, _mm256_loadu_ps(change + i), g);
+        _mm256_storeu_ps(change + i, d);
+        _mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i),
+                                                    _mm256_fmadd_ps(cv, d, g)));
+    }
+    for (; i < n; i++)
+    {
+        change[i] = rate * grad[i] + accel * change[i];
+        weights[i] += accel * change[i] + rate * grad[i];
+    }
+}
+
+AVX2 static void avx2_rmsprop(float *weights, float *square, const float *grad, int n,
+                              float scale, float rate, float decay, float epsilon)
+{
+    int i;
+    float gs;
+    __m256 sv = _mm256_set1_ps(scale);
+    __m256 rv = _mm256_set1_ps(rate);
+    __m256 dv = _mm256_set1_ps(decay);
+    __m256 ev = _mm256_set1_ps(epsilon);
+    __m256 kv = _mm256_set1_ps(1 - decay);
+    __m256 g, q;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        g = _mm256_mul_ps(sv, _mm256_loadu_ps(grad + i));
+        q = _mm256_fmadd_ps(dv, _mm256_loadu_ps(square + i), _mm256_mul_ps(kv, _mm256_mul_ps(g, g)));
+        _mm256_storeu_ps(square + i, q);
+        _mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i),
+                                                    _mm256_div_ps(_mm256_mul_ps(rv, g),
+                                                                  _mm256_add_ps(_mm256_sqrt_ps(q), ev))));
+    }
+    for (; i < n; i++)
+    {
+        gs = scale * grad[i];
+        square[i] = decay * square[i] + (1 - decay) * gs * gs;
+        weights[i] += rate * gs / (sqrtf(square[i]) + epsilon);
+    }
+}
+
+AVX2 static void avx2_adam(float *weights, float *mean, float *square, const float *grad, int n,
+                           float scale, float rate, float beta1, float beta2, float epsilon)
+{
+    int i;
+    float gs;
+    __m256 sv = _mm256_set1_ps(scale);
+    __m256 rv = _mm256_set1_ps(rate);
+    __m256 b1 = _mm256_set1_ps(beta1);
+    __m256 b2 = _mm256_set1_ps(beta2);
+    __m256 k1 = _mm256_set1_ps(1 - beta1);
+    __m256 k2 = _mm256_set1_ps(1 - beta2);
+    __m256 ev = _mm256_set1_ps(epsilon);
+    __m256 g, m, q;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        g = _mm256_mul_ps(sv, _mm256_loadu_ps(grad + i));
+        m = _mm256_fmadd_ps(b1, _mm256_loadu_ps(mean + i), _mm256_mul_ps(k1, g));
+        q = _mm256_fmadd_ps(b2, _mm256_loadu_ps(square + i), _mm256_mul_ps(k2, _mm256_mul_ps(g, g)));
+        _mm256_storeu_ps(mean + i, m);
+        _mm256_storeu_ps(square + i, q);
+        _mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i),
+                                                    _mm256_div_ps(_mm256_mul_ps(rv, m),
+                                                                  _mm256_add_ps(_mm256_sqrt_ps(q), ev))));
+    }
+    for (; i < n; i++)
+    {
+        gs = scale * grad[i];
+        mean[i] = beta1 * mean[i] + (1 - beta1) * gs;
+        square[i] = beta2 * square[i] + (1 - beta2) * gs * gs;
+        weights[i] += rate * mean[i] / (sqrtf(square[i]) + epsilon);
+    }
+}
+
+/* pmaddubsw pairs, safe from saturation as a is at most 127, then pmaddwd */
+AVX2 static int32_t avx2_dot_u8(const uint8_t *a, const int8_t *b, int n)
+{
+    int i;
+    int32_t sum;
+    __m256i s0 = _mm256_setzero_si256();
+    __m256i s1 = _mm256_setzero_si256();
+    __m256i one = _mm256_set1_epi16(1);
+    __m128i h;
+
+    for (i = 0; i + 64 <= n; i += 64)
+    {
+        s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(one, _mm256_maddubs_epi16(
+            _mm256_loadu_si256((const __m256i *) (a + i)), _mm256_loadu_si256((const __m256i *) (b + i)))));
+        s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(one, _mm256_maddubs_epi16(
+            _mm256_loadu_si256((const __m256i *) (a + i + 32)), _mm256_loadu_si256((const __m256i *) (b + i + 32)))));
+    }
+    for (; i + 32 <= n; i += 32)
+    {
+        s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(one, _mm256_maddubs_epi16(
+            _mm256_loadu_si256((const __m256i *) (a + i)), _mm256_loadu_si256((const __m256i *) (b + i)))));
+    }
+    s0 = _mm256_add_epi32(s0, s1);
+    h = _mm_add_epi32(_mm256_castsi256_si128(s0), _mm256_extracti128_si256(s0, 1));
+    h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+    h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+    sum = _mm_cvtsi128_si32(h);
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return (sum);
+}
+
+AVX2 static inline void avx2_fold(__m256 v, int lanes, float *out)
+{
+    sse2_fold(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)), lanes, out);
+}
+
+AVX2 static void avx2_dot_lanes(const float *a, const float *b, int n, int lanes, float *out)
+{
+    int i, o;
+    __m256 s0, s1;
+
+    if (lanes % 8 == 0)
+    {
+        for (o = 0; o < lanes; o += 8)
+        {
+            s0 = _mm256_setzero_ps();
+            for (i = o; i < n; i += lanes)
+            {
+                s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+            }
+            _mm256_storeu_ps(out + o, s0);
+        }
+        return;
+    }
+    s0 = _mm256_setzero_ps();
+    s1 = _mm256_setzero_ps();
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+    }
+    avx2_fold(_mm256_add_ps(s0, s1), lanes, out);
+    for (; i < n; i++)
+    {
+        out[i % lanes] += a[i] * b[i];
+    }
+}
+
+AVX2 static float avx2_dot_sparse(const float *values, const int32_t *columns, int n, const float *x)
+{
+    int i;
+    __m256 s0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps();
+    float sum;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(values + i),
+                             _mm256_i32gather_ps(x, _mm256_loadu_si256((const __m256i *) (columns + i)), 4),
+                             s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(values + i + 8),
+                             _mm256_i32gather_ps(x, _mm256_loadu_si256((const __m256i *) (columns + i + 8)), 4),
+                             s1);
+    }
+    for (; i + 8 <= n; i += 8)
+    {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(values + i),
+                             _mm256_i32gather_ps(x, _mm256_loadu_si256((const __m256i *) (columns + i)), 4),
+                             s0);
+    }
+    sum = avx2_hsum(_mm256_add_ps(s0, s1));
+    for (; i < n; i++)
+    {
+        sum += values[i] * x[columns[i]];
+    }
+    return (sum);
+}
+
+/*
+ * AVX-512, sixteen lanes, tails handled with masked loads and stores
+ */
+AVX512 static inline __mmask16 avx512_tail(int n)
+{
+    return ((__mmask16) ((1u << n) - 1));
+}
+
+AVX512 static inline __m512 avx512_exp(__m512 x)
+{
+    __m512i n;
+    __m512 fx, y, z;
+
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-EXP_LIMIT)), _mm512_set1_ps(EXP_LIMIT));
+    n = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(EXP_LOG2E)));
+    fx = _mm512_cvtepi32_ps(n);
+    x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(EXP_C1), x);
+    x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(EXP_C2), x);
+    z = _mm512_mul_ps(x, x);
+    y = _mm512_set1_ps(EXP_P0);
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P1));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P2));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P3));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P4));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P5));
+    y = _mm512_add_ps(_mm512_fmadd_ps(y, z, x), _mm512_set1_ps(1.0f));
+    n = _mm512_slli_epi32(_mm512_add_epi32(n, _mm512_set1_epi32(127)), 23);
+    return (_mm512_mul_ps(y, _mm512_castsi512_ps(n)));
+}
+
+/* Cubic exp() of ACTIVATION_FAST */
+AVX512 static inline __m512 avx512_fast_exp(__m512 x)
+{
+    __m512i n;
+    __m512 t, y;
+
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-FAST_EXP_LIMIT)),
+                      _mm512_set1_ps(FAST_EXP_LIMIT));
+    t = _mm512_mul_ps(x, _mm512_set1_ps(FAST_EXP_LOG2E));
+    n = _mm512_cvtps_epi32(t);
+    t = _mm512_sub_ps(t, _mm512_cvtepi32_ps(n));
+    y = _mm512_fmadd_ps(_mm512_set1_ps(FAST_EXP_C3), t, _mm512_set1_ps(FAST_EXP_C2));
+    y = _mm512_fmadd_ps(y, t, _mm512_set1_ps(FAST_EXP_C1));
+    y = _mm512_fmadd_ps(y, t, _mm512_set1_ps(FAST_EXP_C0));
+    n = _mm512_slli_epi32(_mm512_add_epi32(n, _mm512_set1_epi32(127)), 23);
+    return (_mm512_mul_ps(y, _mm512_castsi512_ps(n)));
+}
+
+/* 1 / d from the 14 bit estimate and one Newton step */
+AVX512 static inline __m512 avx512_recip(__m512 d)
+{
+    __m512 r = _mm512_rcp14_ps(d);
+
+    return (_mm512_mul_ps(r, _mm512_fnmadd_ps(d, r, _mm512_set1_ps(2.0f))));
+}
+
+AVX512 static float avx512_dot(const float *a, const float *b, int n)
+{
+    int i;
+    __m512 s0 = _mm512_setzero_ps();
+    __m512 s1 = _mm512_setzero_ps();
+    __mmask16 m;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+        s1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), s1);
+    }
+    for (; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        s0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), s0);
+    }
+    return (_mm512_reduce_add_ps(_mm512_add_ps(s0, s1)));
+}
+
+/* Full 4 x 4 block, sixteen accumulators out of thirty two registers */
+AVX512 static void avx512_tile(int k, const float *a, int lda, const float *b, int ldb,
+                               float *c, int ldc)
+{
+    int i, j, p;
+    __m512 acc[4][4], av[4], bv;
+    __mmask16 m;
+
+    for (i = 0; i < 4; i++)
+    {
+        for (j = 0; j < 4; j++)
+        {
+            acc[i][j] = _mm512_setzero_ps();
+        }
+    }
+    for (p = 0; p < k; p += 16)
+    {
+        m = k - p >= 16 ? 0xffff : avx512_tail(k - p);
+        for (i = 0; i < 4; i++)
+        {
+            av[i] = _mm512_maskz_loadu_ps(m, a + (size_t) i * lda + p);
+        }
+        for (j = 0; j < 4; j++)
+        {
+            bv = _mm512_maskz_loadu_ps(m, b + (size_t) j * ldb + p);
+            for (i = 0; i < 4; i++)
+            {
+                acc[i][j] = _mm512_fmadd_ps(av[i], bv, acc[i][j]);
+            }
+        }
+    }
+    for (i = 0; i < 4; i++)
+    {
+        for (j = 0; j < 4; j++)
+        {
+            c[(size_t) i * ldc + j] += _mm512_reduce_add_ps(acc[i][j]);
+        }
+    }
+}
+
+AVX512 static void avx512_axpy(float *y, float alpha, const float *x, int n)
+{
+    int i;
+    __m512 av = _mm512_set1_ps(alpha);
+    __mmask16 m;
+
+    for (i = 0; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        _mm512_mask_storeu_ps(y + i, m, _mm512_fmadd_ps(av, _mm512_maskz_loadu_ps(m, x + i),
+                                                        _mm512_maskz_loadu_ps(m, y + i)));
+    }
+}
+
+AVX512 static void avx512_bias_sigmoid(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+    __m512 v;
+    __m512 one = _mm512_set1_ps(1.0f);
+    __mmask16 m;
+
+    for (i = 0; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        v = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, threshold + i));
+        v = _mm512_min_ps(_mm512_max_ps(v, _mm512_set1_ps(-SIGMOID_LIMIT)),
+                          _mm512_set1_ps(SIGMOID_LIMIT));
+        v = avx512_exp(_mm512_mul_ps(v, _mm512_set1_ps(slope)));
+        _mm512_mask_storeu_ps(x + i, m, _mm512_div_ps(one, _mm512_add_ps(one, v)));
+    }
+}
+
+AVX512 static void avx512_bias_fast_sigmoid(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+    __m512 v;
+    __m512 one = _mm512_set1_ps(1.0f);
+    __mmask16 m;
+
+    for (i = 0; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        v = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, threshold + i));
+        v = avx512_fast_exp(_mm512_mul_ps(v, _mm512_set1_ps(slope)));
+        _mm512_mask_storeu_ps(x + i, m, avx512_recip(_mm512_add_ps(one, v)));
+    }
+}
+
+AVX512 static void avx512_bias_tanh(float *x, const float *threshold, int n, float slope)
+{
+    int i;
+    __m512 v;
+    __m512 one = _mm512_set1_ps(1.0f);
+    __mmask16 m;
+
+    for (i = 0; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        v = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, threshold + i));
+        v = avx512_exp(_mm512_mul_ps(v, _mm512_set1_ps(-2 * slope)));
+        v = _mm512_div_ps(_mm512_set1_ps(2.0f), _mm512_add_ps(one, v));
+        _mm512_mask_storeu_ps(x + i, m, _mm512_sub_ps(one, v));
+    }
+}
+
+AVX512 static void avx512_bias_relu(float *x, const float *threshold, int n, float leak)
+{
+    int i;
+    __m512 u;
+    __mmask16 m;
+
+    for (i = 0; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        u = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, threshold + i));
+        _mm512_mask_storeu_ps(x + i, m, _mm512_max_ps(u, _mm512_mul_ps(u, _mm512_set1_ps(leak))));
+    }
+}
+
+AVX512 static void avx512_momentum(float *weights, float *change, const float *grad, int n,
+                                   float rate, float accel)
+{
+    int i;
+    __m512 rv = _mm512_set1_ps(rate);
+    __m512 cv = _mm512_set1_ps(accel);
+    __m512 d;
+    __mmask16 m;
+
+    for (i = 0; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        d = _mm512_fmadd_ps(rv, _mm512_maskz_loadu_ps(m, grad + i),
+                            _mm512_mul_ps(cv, _mm512_maskz_loadu_ps(m, change + i)));
+        _mm512_mask_storeu_ps(change + i, m, d);
+        _mm512_mask_storeu_ps(weights + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, weights + i), d));
+    }
+}
+
+AVX512 static void avx512_nesterov(float *weights, float *change, const float *grad, int n,
+                                   float rate, float accel)
+{
+    int i;
+    __m512 rv = _mm512_set1_ps(rate);
+    __m512 cv = _mm512_set1_ps(accel);
+    __m512 g, d;
+    __mmask16 m;
+
+    for (i = 0; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        g = _mm512_mul_ps(rv, _mm512_maskz_loadu_ps(m, grad + i));
+        d = _mm512_fmadd_ps(cv, _mm512_maskz_loadu_ps(m, change + i), g);
+        _mm512_mask_storeu_ps(change + i, m, d);
+        _mm512_mask_storeu_ps(weights + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, weights + i),
+                                                            _mm512_fmadd_ps(cv, d, g)));
+    }
+}
+
+AVX512 static void avx512_rmsprop(float *weights, float *square, const float *grad, int n,
+                                  float scale, float rate, float decay, float epsilon)
+{
+    int i;
+    __m512 sv = _mm512_set1_ps(scale);
+    __m512 rv = _mm512_set1_ps(rate);
+    __m512 dv = _mm512_set1_ps(decay);
+    __m512 ev = _mm512_set1_ps(epsilon);
+    __m512 kv = _mm512_set1_ps(1 - decay);
+    __m512 g, q;
+    __mmask16 m;
+
+    for (i = 0; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        g = _mm512_mul_ps(sv, _mm512_maskz_loadu_ps(m, grad + i));
+        q = _mm512_fmadd_ps(dv, _mm512_maskz_loadu_ps(m, square + i), _mm512_mul_ps(kv, _mm512_mul_ps(g, g)));
+        _mm512_mask_storeu_ps(square + i, m, q);
+        _mm512_mask_storeu_ps(weights + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, weights + i),
+                                                            _mm512_div_ps(_mm512_mul_ps(rv, g),
+                                                                          _mm512_add_ps(_mm512_sqrt_ps(q), ev))));
+    }
+}
+
+AVX512 static void avx512_adam(float *weights, float *mean, float *square, const float *grad, int n,
+                               float scale, float rate, float beta1, float beta2, float epsilon)
+{
+    int i;
+    __m512 sv = _mm512_set1_ps(scale);
+    __m512 rv = _mm512_set1_ps(rate);
+    __m512 b1 = _mm512_set1_ps(beta1);
+    __m512 b2 = _mm512_set1_ps(beta2);
+    __m512 k1 = _mm512_set1_ps(1 - beta1);
+    __m512 k2 = _mm512_set1_ps(1 - beta2);
+    __m512 ev = _mm512_set1_ps(epsilon);
+    __m512 g, a, q;
+    __mmask16 m;
+
+    for (i = 0; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        g = _mm512_mul_ps(sv, _mm512_maskz_loadu_ps(m, grad + i));
+        a = _mm512_fmadd_ps(b1, _mm512_maskz_loadu_ps(m, mean + i), _mm512_mul_ps(k1, g));
+        q = _mm512_fmadd_ps(b2, _mm512_maskz_loadu_ps(m, square + i), _mm512_mul_ps(k2, _mm512_mul_ps(g, g)));
+        _mm512_mask_storeu_ps(mean + i, m, a);
+        _mm512_mask_storeu_ps(square + i, m, q);
+        _mm512_mask_storeu_ps(weights + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, weights + i),
+                                                            _mm512_div_ps(_mm512_mul_ps(rv, a),
+                                                                          _mm512_add_ps(_mm512_sqrt_ps(q), ev))));
+    }
+}
+
+/* vpdpbusd, four byte products summed straight into each 32 bit lane */
+AVX512VNNI static int32_t avx512_vnni_dot_u8(const uint8_t *a, const int8_t *b, int n)
+{
+    int i;
+    __m512i s0 = _mm512_setzero_si512();
+    __m512i s1 = _mm512_setzero_si512();
+    __mmask64 m;
+
+    for (i = 0; i + 128 <= n; i += 128)
+    {
+        s0 = _mm512_dpbusd_epi32(s0, _mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        s1 = _mm512_dpbusd_epi32(s1, _mm512_loadu_si512(a + i + 64), _mm512_loadu_si512(b + i + 64));
+    }
+    for (; i < n; i += 64)
+    {
+        m = n - i >= 64 ? ~(__mmask64) 0 : ((__mmask64) 1 << (n - i)) - 1;
+        s0 = _mm512_dpbusd_epi32(s0, _mm512_maskz_loadu_epi8(m, a + i), _mm512_maskz_loadu_epi8(m, b + i));
+    }
+    return (_mm512_reduce_add_epi32(_mm512_add_epi32(s0, s1)));
+}
+
+AVX512 static void avx512_dot_lanes(const float *a, const float *b, int n, int lanes, float *out)
+{
+    int i, o;
+    __m512 s0, s1;
+    __mmask16 m;
+    __m256 h;
+
+    if (lanes % 16 == 0)
+    {
+        for (o = 0; o < lanes; o += 16)
+        {
+            s0 = _mm512_setzero_ps();
+            for (i = o; i < n; i += lanes)
+            {
+                s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+            }
+            _mm512_storeu_ps(out + o, s0);
+        }
+        return;
+    }
+    s0 = _mm512_setzero_ps();
+    s1 = _mm512_setzero_ps();
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+        s1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), s1);
+    }
+    /* The tail starts on a multiple of 16 so lane l stays lane l */
+    for (; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        s0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), s0);
+    }
+    /* Halves added until lanes sums are left */
+    s0 = _mm512_add_ps(s0, s1);
+    h = _mm256_add_ps(_mm512_castps512_ps256(s0),
+                      _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(s0), 1)));
+    if (lanes == 8)
+    {
+        _mm256_storeu_ps(out, h);
+        return;
+    }
+    sse2_fold(_mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1)), lanes, out);
+}
+
+/* The masked gather of the tail reads no column past n */
+AVX512 static float avx512_dot_sparse(const float *values, const int32_t *columns, int n, const float *x)
+{
+    int i;
+    __m512 s0 = _mm512_setzero_ps();
+    __m512 s1 = _mm512_setzero_ps();
+    __mmask16 m;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        s0 = _mm512_fmadd_ps(_mm512_loadu_ps(values + i),
+                             _mm512_i32gather_ps(_mm512_loadu_si512(columns + i), x, 4), s0);
+        s1 = _mm512_fmadd_ps(_mm512_loadu_ps(values + i + 16),
+                             _mm512_i32gather_ps(_mm512_loadu_si512(columns + i + 16), x, 4), s1);
+    }
+    for (; i < n; i += 16)
+    {
+        m = n - i >= 16 ? 0xffff : avx512_tail(n - i);
+        s0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, values + i),
+                             _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m,
+                                                      _mm512_maskz_loadu_epi32(m, columns + i), x, 4),
+                             s0);
+    }
+    return (_mm512_reduce_add_ps(_mm512_add_ps(s0, s1)));
+}
+
+#else
+
+/* No vector tables on this target, the scalar one is used */
+void kernel_detect(void)
+{
+}
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * File: layer.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ */
+#include "layer.h"
+
+/* Prototypes */
+static void layer_destruct(Layer *this);
+static void layer_print(Layer *this);
+static Layer * layer_standalone(const LayerSpec *spec);
+
+/* Instantiate a new object with randomised weights */
+Layer * layer_construct(int count, int inputCnt, float slope)
+{
+    LayerSpec spec;
+
+    memset(&spec, 0, sizeof (spec));
+    spec.count = count;
+    spec.inputCnt = inputCnt;
+    spec.slope = slope;
+    return (layer_standalone(&spec));
+}
+
+/*
+ * Instantiate a layer over weights and thresholds it does not own, such as
+ * the pages of a mapped model file. They are never written here or freed.
+ */
+Layer * layer_construct_mapped(int count, int inputCnt, int stride, float slope,
+                               float *weights, float *threshold)
+{
+    LayerSpec spec;
+
+    memset(&spec, 0, sizeof (spec));
+    spec.count = count;
+    spec.inputCnt = inputCnt;
+    spec.stride = stride;
+    spec.slope = slope;
+    spec.weights = weights;
+    spec.threshold = threshold;
+    return (layer_standalone(&spec));
+}
+
+/* A layer in an arena of its own, released with it */
+static Layer * layer_standalone(const LayerSpec *spec)
+{
+    Arena arena;
+    Layer *this;
+
+    arena_open(&arena, layer_bytes(spec));
+    this = layer_carve(&arena, spec);
+    this->arena = arena;
+    this->stateFlag |= LAYER_ARENA;
+    return (this);
+}
+
+/* Row pitch of spec in elements, a whole number of cache lines */
+int layer_stride(const LayerSpec *spec)
+{
+    if (spec->stride)
+    {
+        return (spec->stride);
+    }
+    return ((spec->inputCnt + LAYER_ALIGN / sizeof (float) - 1)
+            & ~(int) (LAYER_ALIGN / sizeof (float) - 1));
+}
+
+/* Arena room layer_carve takes for spec */
+size_t layer_bytes(const LayerSpec *spec)
+{
+    size_t rows = (size_t) spec->count * layer_stride(spec) * sizeof (float);
+    size_t vec = arena_round(spec->count * sizeof (float));
+    size_t bytes;
+
+    bytes = arena_round(sizeof (Layer)) + arena_round(rows)
+            + arena_round(layer_stride(spec) * sizeof (float)) + 5 * vec
+            + arena_round(spec->count * sizeof (Neuron));
+    /* Parameters, unless borrowed */
+    if (spec->weights == NULL)
+    {
+        bytes += arena_round(rows) + vec;
+    }
+    return (bytes);
+}
+
+/* Build a layer from pieces of arena, which must have layer_bytes(spec)
+ * left. The arena starts zeroed, so only the parameters are set here. */
+Layer * layer_carve(Arena *arena, const LayerSpec *spec)
+{
+    int i;
+    size_t rows, vec;
+    Layer *this = NULL;
+
+    this = arena_take(arena, sizeof (Layer));
+    /* Set initial values for data members */
+    this->cls = LAYER;
+    this->count = spec->count;
+    this->inputCnt = spec->inputCnt;
+    this->stride = layer_stride(spec);
+    this->stateFlag = 0;
+    this->slope = spec->slope;
+    this->activation = spec->activation;
+    this->dispatcher = (void *) layer_dispatcher; /* Add the dispatcher pointer */
+
+    rows = (size_t) this->count * this->stride * sizeof (float);
+    vec = (size_t) this->count * sizeof (float);
+    if (spec->weights == NULL)
+    {
+        /* Padding columns stay zero so whole rows can be processed */
+        this->weights = arena_take(arena, rows);
+        this->threshold = arena_take(arena, vec);
+    }
+    else
+    {
+        this->weights = spec->weights;
+        this->threshold = spec->threshold;
+        this->stateFlag |= LAYER_MAPPED;
+    }
+    this->wchange = arena_take(arena, rows);
+    this->staged = arena_take(arena, this->stride * sizeof (float));
+    this->tchange = arena_take(arena, vec);
+    this->desired = arena_take(arena, vec);
+    this->error = arena_take(arena, vec);
+    this->active = arena_take(arena, vec);
+    this->output = arena_take(arena, vec);
+    this->neurons = arena_take(arena, this->count * sizeof (Neuron));
+    this->input = this->staged;
+
+    for (i = 0; i < this->count; i++)
+    {
+        neuron_view_init(&this->neurons[i], this, i);
+        if (spec->weights == NULL)
+        {
+            neuron_randomize(&this->neurons[i]);
+        }
+    }
+    return (this);
+}
+
+/* Do any clean up needed. The memory goes with the arena, a layer carved
+ * from an arena it does not own is released by the owner closing it */
+static void layer_destruct(Layer *this)
+{
+    int i;
+    Arena arena;
+
+    for (i = 0; i < this->count; i++)
+    {
+        NeuronDestroy((&this->neurons[i]));
+    }
+    if (this->stateFlag & LAYER_ARENA)
+    {
+        /* The arena holds this Layer too, copy it out first */
+        arena = this->arena;
+        arena_close(&arena);
+    }
+}
+
+/* Cache line aligned allocation, exits on failure like the constructors */
+void * layer_alloc(size_t size)
+{
+    void *ptr = NULL;
+
+    if (posix_memalign(&ptr, LAYER_ALIGN, size ? size : LAYER_ALIGN) != 0)
+    {
+        printf("Layer: ::layer_alloc Memory allocation failed");
+        exit(1);
+    }
+    return (ptr);
+}
+
+static void layer_print(Layer *this)
+{
+    printf("Layer: Count = %d InputCnt = %d Stride = %d Slope = %f Activation = %s\n",
+           this->count, this->inputCnt, this->stride, this->slope,
+           activation_name(this->activation));
+}
+
+void layer_dispatcher(Layer *this, int mthd, int attr, Msg *msg)
+{
+    switch (mthd)
+    {
+    case(LAYER_DESTROY): layer_destruct(this);
+        break;
+    case(LAYER_PRINT): layer_print(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Layer: ::layer_dispatcher: Unknown method %d\n", mthd);
+    }
+}
@@ -0,0 +1,146 @@
+/*
+ * File: layer.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ *
+ * A layer owns the storage for all of its neurons. Weights, momentum,
+ * thresholds and activations are held in contiguous, 64 byte aligned,
+ * row major matrices (one row per neuron) so a pass over the layer walks
+ * memory linearly. The Neuron objects of a layer are views onto a row.
+ *
+ * All of it, the Layer itself included, is carved from one arena. A
+ * standalone layer opens an arena of its own; a network carves its layers
+ * from the arena it holds everything in and layer_bytes says how much each
+ * needs.
+ */
+#ifndef LAYER_H
+#define	LAYER_H
+
+#include "neuron.h"
+#include "activation.h"
+#include "arena.h"
+/* Class Id */
+#define LAYER               (('L'+'A'+'Y'+'E'+'R') << 16)
+/* Methods */
+#define LAYER_DESTROY       LAYER + 1
+#define LAYER_PRINT         LAYER + 2
+/* State flags */
+#define LAYER_MAPPED        0x01    /* weights and threshold are borrowed */
+#define LAYER_ARENA         0x02    /* Owns the arena it was carved from */
+/* Other */
+#define LAYER_ALIGN         ARENA_ALIGN /* bytes, one cache line */
+
+/* Shape of a layer to be built. stride 0 pads inputCnt to LAYER_ALIGN;
+ * weights NULL gives fresh random parameters, otherwise the layer borrows
+ * weights and threshold, as from a mapped model file. */
+typedef struct
+{
+    int count;
+    int inputCnt;
+    int stride;
+    float slope;
+    int activation;
+    float *weights;
+    float *threshold;
+} LayerSpec;
+
+/* If this class is using multiple inheritance; add the class ID and use a
+ * class dispatcher to send the super classes methods */
+struct _Layer
+{
+    int cls;
+    int count;          /* Neurons, rows of each matrix */
+    int inputCnt;       /* Fan-in, used columns of each matrix */
+    int stride;         /* Row pitch in elements, padded to LAYER_ALIGN */
+    int stateFlag;
+    /* Parameters, the only members the batched inference path reads */
+    float slope;
+    int activation;     /* ACTIVATION_ id, logistic unless changed */
+    float *weights;     /* count x stride */
+    float *threshold;   /* count */
+    /* Training state */
+    float *wchange;     /* count x stride */
+    float *tchange;     /* count */
+    /* Per call state of the Neuron (Msg) path, never touched by ann_infer */
+    const float *input; /* inputCnt wide vector every neuron reads, in a
+                         * network the active vector of the layer before */
+    float *staged;      /* stride, inputs loaded with neuron_load_inputs */
+    float *desired;     /* count */
+    float *error;
+    float *active;
+    float *output;
+    /* Neuron views, one per row */
+    Neuron *neurons;
+    Arena arena;        /* Closed unless LAYER_ARENA */
+    void (*dispatcher)(Layer * this, int mthd, int attr, Msg * msg);
+};
+
+/* Prototypes */
+Layer * layer_construct(int count, int inputCnt, float slope);
+Layer * layer_construct_mapped(int count, int inputCnt, int stride, float slope,
+                               float *weights, float *threshold);
+Layer * layer_carve(Arena * arena, const LayerSpec * spec);
+size_t layer_bytes(const LayerSpec * spec);
+int layer_stride(const LayerSpec * spec);
+void layer_dispatcher(Layer * this, int mthd, int attr, Msg * msg);
+void * layer_alloc(size_t size);
+/* Macros */
+#define LayerNew(count, inputCnt, slope)    ((layer_construct)(count, inputCnt, slope))
+#define LayerNewMapped(count, inputCnt, stride, slope, weights, threshold) \
+    ((layer_construct_mapped)(count, inputCnt, stride, slope, weights, threshold))
+#define LayerDestroy(this)                  ((this->dispatcher)(this, LAYER_DESTROY, 0, NULL))
+#define LayerPrint(this)                    ((this->dispatcher)(this, LAYER_PRINT,   0, NULL))
+#define LayerRow(this, m, i)                ((this)->m + (size_t) (i) * (this)->stride)
+
+/* Direct calls for the hot neuron operations. They do the work of the
+ * CALC_OUTPUT, CALC_ERROR, ADJUST_WEIGHTS and ADJUST_THRESHOLD methods with
+ * no dispatcher switch and no Msg, so a loop over a layer inlines them. */
+static inline float neuron_output(Neuron *this)
+{
+    float sum;
+
+    /* weights * inputs - threshold */
+    sum = kernel_dot(this->weights, this->layer->input, this->inputCnt);
+    NeuronField(this, output) = sum - NeuronField(this, threshold);
+    NeuronField(this, active) = activation_apply(this->layer->activation, this->slope,
+                                                 NeuronField(this, output));
+    return (NeuronField(this, active));
+}
+
+/* Output layer error */
+static inline float neuron_output_error(Neuron *this, float desired)
+{
+    float active = NeuronField(this, active);
+
+    NeuronField(this, desired) = desired;
+    NeuronField(this, error) = (desired - active) * activation_derivative(this->layer->activation, active);
+    return (NeuronField(this, error));
+}
+
+/* Hidden and input layer error, sum is the error fed back from above */
+static inline float neuron_hidden_error(Neuron *this, float sum)
+{
+    float active = NeuronField(this, active);
+
+    NeuronField(this, error) = activation_derivative(this->layer->activation, active) * sum;
+    return (NeuronField(this, error));
+}
+
+static inline void neuron_weights_step(Neuron *this, float LR, float ACL)
+{
+    /* LR * error * input + ACL * lastChange */
+    kernel_momentum(this->weights, this->wchange, this->layer->input, this->inputCnt,
+                    LR * NeuronField(this, error), ACL);
+}
+
+static inline void neuron_threshold_step(Neuron *this, float LR, float ACL)
+{
+    /* ACL * lastChange - LR * error * 1, tchange holds the step added as
+     * wchange does and as ann_train leaves it */
+    NeuronField(this, tchange) = ACL * NeuronField(this, tchange) - LR * NeuronField(this, error);
+    NeuronField(this, threshold) += NeuronField(this, tchange);
+}
+
+#endif	/* LAYER_H */
@@ -8,33 +8,204 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
+#include <signal.h>
 #include "neuron.h"
 #include "ann.h"
+#include "model.h"
+#include "dataset.h"
+#include "trainer.h"
+#include "server.h"
+#include "random.h"
 /* Prototypes */
-static void randomize(void);
+static void train(Ann *ann, const char *path, int epochs, unsigned long seed, float holdout,
+                  int patience, const char *checkpoint);
+static int write_profile(Ann *ann, const char *path);
+static int serve(Ann *ann, const char *address, int batch, long delay);
+static void stop_serving(int sig);
+/* Globals */
+static Server *serving;
 
-int main(void)
+int main(int argc, char *argv[])
 {
 	Ann *myann;
         Msg msg;
+        const char *load = NULL, *save = NULL, *data = NULL, *profile = NULL, *checkpoint = NULL;
+        const char *address = NULL;
+        int opt, epochs = 1, rule = -1, patience = TRAINER_PATIENCE, batch = SERVER_BATCH;
+        long delay = SERVER_DELAY;
+        float rate = -1, holdout = 0;
+        unsigned long seed = (unsigned long) time(NULL);
         
+        /* -l model starts from a saved network, -s model saves it,
+         * -t data trains on a CSV or packed data set for -e epochs,
+         * -r seed repeats a run, the time is used otherwise,
+         * -p file writes the profile counters to file as JSON,
+         * -o momentum|nesterov|rmsprop|adam picks the update rule of -t
+         * and -a rate its learning rate,
+         * -v share holds out that share of -t to validate on, stopping once
+         * -w epochs pass without improving (0 runs them all) and saving the
+         * best network to -c model as it goes,
+         * -S unix:path|[host:]port serves the network until interrupted,
+         * -m requests per pass, within -d microseconds of the first */
+        while ((opt = getopt(argc, argv, "l:s:t:e:r:p:o:a:v:w:c:S:m:d:")) != -1)
+        {
+            switch (opt)
+            {
+            case 'l': load = optarg;
+                break;
+            case 's': save = optarg;
+                break;
+            case 't': data = optarg;
+                break;
+            case 'e': epochs = atoi(optarg);
+                break;
+            case 'r': seed = strtoul(optarg, NULL, 0);
+                break;
+            case 'p': profile = optarg;
+                break;
+            case 'o': rule = optim_rule(optarg);
+                if (rule < 0)
+                {
+                    printf("Unknown optimiser %s\n", optarg);
+                    return(EXIT_FAILURE);
+                }
+                break;
+            case 'a': rate = atof(optarg);
+                break;
+            case 'v': holdout = atof(optarg);
+                break;
+            case 'w': patience = atoi(optarg);
+                break;
+            case 'c': checkpoint = optarg;
+                break;
+            case 'S': address = optarg;
+                break;
+            case 'm': batch = atoi(optarg);
+                break;
+            case 'd': delay = atol(optarg);
+                break;
+            default: printf("Usage: %s [-l model] [-s model] [-t data [-e epochs]] [-r seed] [-p file]"
+                            " [-o optimiser] [-a rate] [-v share [-w patience] [-c model]]"
+                            " [-S address [-m batch] [-d delay]]\n", argv[0]);
+                return(EXIT_FAILURE);
+            }
+        }
         msg.desired = 1002;
-        randomize();
+        random_global_seed(seed);
         
-	myann = AnnNew(5, 7, 5, 0.5, 0.3, -3);
+        if (load != NULL)
+        {
+            myann = AnnLoad(load);
+            if (myann == NULL)
+            {
+                return(EXIT_FAILURE);
+            }
+        }
+        else
+        {
+            myann = AnnNew(5, 7, 5, 0.5, 0.3, -3);
+        }
+        if (profile != NULL)
+        {
+            msg.profile = 1;
+            AnnSet(myann, ANN_PROFILE, &msg);
+        }
+        if (rule >= 0 || rate >= 0)
+        {
+            msg.optimiser = rule;
+            msg.LR = rate;
+            msg.ACL = -1;
+            AnnSet(myann, ANN_OPTIMISER, &msg);
+        }
+        if (data != NULL)
+        {
+            train(myann, data, epochs, seed, holdout, patience, checkpoint);
+        }
 	AnnPrint(myann);
+        if (address != NULL && !serve(myann, address, batch, delay))
+        {
+            AnnDestroy(myann);
+            return(EXIT_FAILURE);
+        }
+        if (profile != NULL && !write_profile(myann, profile))
+        {
+            AnnDestroy(myann);
+            return(EXIT_FAILURE);
+        }
+        if (save != NULL && AnnSave(myann, save) != 0)
+        {
+            AnnDestroy(myann);
+            return(EXIT_FAILURE);
+        }
         AnnDestroy(myann);
 	
 	return(EXIT_SUCCESS);
 }
 
-static void randomize(void)
+/* Train on a data set for up to epochs, validating on the share held out
+ * of it */
+static void train(Ann *ann, const char *path, int epochs, unsigned long seed, float holdout,
+                  int patience, const char *checkpoint)
 {
-    time_t ltime;
-    unsigned int stime;
+    Dataset *data;
+    Trainer *trainer;
 
-    ltime = time(NULL);
-    ltime = ltime << 21;
-    stime = (unsigned) ltime / 2;
-    srand(stime);
+    data = DatasetNewSplit(path, ann->input_count, ann->output_count, 0, (unsigned) seed, holdout);
+    if (data == NULL)
+    {
+        return;
+    }
+    trainer = TrainerNew(ann, data, epochs);
+    trainer->patience = patience;
+    trainer->checkpoint = checkpoint;
+    TrainerRun(trainer);
+    TrainerDestroy(trainer);
+    DatasetDestroy(data);
+}
+
+/* Profile counters as JSON, 1 when written */
+static int write_profile(Ann *ann, const char *path)
+{
+    FILE *fp = fopen(path, "w");
+
+    if (fp == NULL)
+    {
+        printf("Cannot create %s\n", path);
+        return (0);
+    }
+    ProfileJson(ann->profile, fp);
+    return (fclose(fp) == 0);
+}
+
+/* Answer requests on address until SIGINT or SIGTERM, 1 when served */
+static int serve(Ann *ann, const char *address, int batch, long delay)
+{
+    struct sigaction sa;
+
+    serving = ServerNew(ann, address, batch, delay);
+    if (serving == NULL)
+    {
+        return (0);
+    }
+    /* No SA_RESTART, the signal cuts the accept loop short */
+    memset(&sa, 0, sizeof (sa));
+    sa.sa_handler = stop_serving;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    printf("Serving on %s\n", address);
+    fflush(stdout);
+    ServerRun(serving);
+    ServerDestroy(serving);
+    serving = NULL;
+    return (1);
+}
+
+static void stop_serving(int sig)
+{
+    if (serving != NULL)
+    {
+        ServerStop(serving);
+    }
 }
@@ -0,0 +1,249 @@
+/*
+ * File: model.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "model.h"
+
+/* Prototypes */
+static uint64_t model_align(uint64_t offset);
+static int model_pad(FILE *fp, uint64_t from, uint64_t to);
+static int model_check(const ModelHeader *head, const ModelLayer *rec, size_t size);
+static void * model_alloc(size_t size);
+
+/* Write ann to path, returns 0 or -1 when the file could not be written */
+int model_save(const Ann *ann, const char *path)
+{
+    int i, count = ann->layer_count;
+    FILE *fp;
+    uint64_t offset, end;
+    ModelHeader head;
+    ModelLayer *rec;
+    Layer **layers = ann->layers;
+    size_t table = count * sizeof (ModelLayer);
+
+    /* Lay the blocks out after the header and layer table */
+    rec = model_alloc(table);
+    memset(rec, 0, table);
+    offset = sizeof (ModelHeader) + table;
+    for (i = 0; i < count; i++)
+    {
+        rec[i].count = layers[i]->count;
+        rec[i].input_count = layers[i]->inputCnt;
+        rec[i].stride = layers[i]->stride;
+        rec[i].activation = layers[i]->activation;
+        rec[i].slope = layers[i]->slope;
+        rec[i].weights = offset = model_align(offset);
+        offset += (uint64_t) layers[i]->count * layers[i]->stride * sizeof (float);
+        rec[i].threshold = offset = model_align(offset);
+        offset += (uint64_t) layers[i]->count * sizeof (float);
+    }
+    end = model_align(offset);
+    memset(&head, 0, sizeof (head));
+    memcpy(head.magic, MODEL_MAGIC, sizeof (head.magic));
+    head.endian = MODEL_ENDIAN;
+    head.version = MODEL_VERSION;
+    head.layer_count = count;
+    head.learning_rate = ann->learning_rate;
+    head.accel_rate = ann->accel_rate;
+    head.slope = ann->slope;
+    head.file_size = end;
+
+    fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        printf("Model: ::model_save Cannot create %s\n", path);
+        free(rec);
+        return (-1);
+    }
+    offset = sizeof (head) + table;
+    if (fwrite(&head, sizeof (head), 1, fp) != 1 || fwrite(rec, table, 1, fp) != 1)
+    {
+        goto fail;
+    }
+    for (i = 0; i < count; i++)
+    {
+        size_t rows = (size_t) layers[i]->count * layers[i]->stride;
+
+        if (model_pad(fp, offset, rec[i].weights) != 0
+            || fwrite(layers[i]->weights, sizeof (float), rows, fp) != rows)
+        {
+            goto fail;
+        }
+        offset = rec[i].weights + rows * sizeof (float);
+        if (model_pad(fp, offset, rec[i].threshold) != 0
+            || fwrite(layers[i]->threshold, sizeof (float), layers[i]->count, fp)
+               != (size_t) layers[i]->count)
+        {
+            goto fail;
+        }
+        offset = rec[i].threshold + layers[i]->count * sizeof (float);
+    }
+    if (model_pad(fp, offset, end) != 0)
+    {
+        goto fail;
+    }
+    free(rec);
+    if (fclose(fp) != 0)
+    {
+        printf("Model: ::model_save Write to %s failed\n", path);
+        return (-1);
+    }
+    return (0);
+
+fail:
+    printf("Model: ::model_save Write to %s failed\n", path);
+    free(rec);
+    fclose(fp);
+    return (-1);
+}
+
+/* Map the model at path and build a network over it, NULL on failure */
+Ann * model_load(const char *path)
+{
+    int i, fd;
+    void *map;
+    size_t size;
+    struct stat st;
+    const ModelHeader *head;
+    const ModelLayer *rec;
+    LayerSpec *spec;
+    Ann *ann;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        printf("Model: ::model_load Cannot open %s\n", path);
+        return (NULL);
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof (ModelHeader))
+    {
+        printf("Model: ::model_load %s is not a model file\n", path);
+        close(fd);
+        return (NULL);
+    }
+    size = (size_t) st.st_size;
+    /* Private and writable so training a loaded network copies on write */
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        printf("Model: ::model_load Cannot map %s\n", path);
+        return (NULL);
+    }
+    head = map;
+    rec = (const ModelLayer *) (head + 1);
+    if (model_check(head, rec, size) != 0)
+    {
+        printf("Model: ::model_load %s is not a usable model file\n", path);
+        munmap(map, size);
+        return (NULL);
+    }
+    /* Layers borrow their parameters from the mapping */
+    spec = model_alloc(head->layer_count * sizeof (LayerSpec));
+    for (i = 0; i < (int) head->layer_count; i++)
+    {
+        spec[i].count = rec[i].count;
+        spec[i].inputCnt = rec[i].input_count;
+        spec[i].stride = rec[i].stride;
+        spec[i].slope = rec[i].slope;
+        spec[i].activation = rec[i].activation;
+        spec[i].weights = (float *) ((char *) map + rec[i].weights);
+        spec[i].threshold = (float *) ((char *) map + rec[i].threshold);
+    }
+    ann = ann_construct_spec(head->layer_count, spec, head->learning_rate, head->accel_rate,
+                             head->slope);
+    free(spec);
+    if (ann == NULL)
+    {
+        munmap(map, size);
+        return (NULL);
+    }
+    ann->map = map;
+    ann->map_size = size;
+    return (ann);
+}
+
+/* Validate everything the layers will be pointed at, 0 when usable */
+static int model_check(const ModelHeader *head, const ModelLayer *rec, size_t size)
+{
+    int i;
+    uint64_t rows;
+
+    if (memcmp(head->magic, MODEL_MAGIC, sizeof (head->magic)) != 0
+        || head->endian != MODEL_ENDIAN
+        || head->version != MODEL_VERSION
+        || head->layer_count < 2 || head->layer_count > MODEL_MAX_LAYERS
+        || head->file_size != size
+        || size < sizeof (ModelHeader) + head->layer_count * sizeof (ModelLayer))
+    {
+        return (-1);
+    }
+    for (i = 0; i < (int) head->layer_count; i++)
+    {
+        if (rec[i].count == 0 || rec[i].count > INT32_MAX
+            || rec[i].input_count == 0 || rec[i].input_count > rec[i].stride
+            || rec[i].stride % (LAYER_ALIGN / sizeof (float)) != 0
+            || rec[i].activation >= ACTIVATION_COUNT)
+        {
+            return (-1);
+        }
+        /* Each layer sees the one before, the input layer the raw inputs
+         * of whatever width the network takes */
+        if (i > 0 && rec[i].input_count != rec[i - 1].count)
+        {
+            return (-1);
+        }
+        rows = (uint64_t) rec[i].count * rec[i].stride * sizeof (float);
+        if (rec[i].weights % LAYER_ALIGN != 0 || rec[i].threshold % LAYER_ALIGN != 0
+            || rec[i].weights > size || rows > size - rec[i].weights
+            || rec[i].threshold > size || rec[i].count * sizeof (float) > size - rec[i].threshold)
+        {
+            return (-1);
+        }
+    }
+    return (0);
+}
+
+/* Allocation that exits on failure like the constructors */
+static void * model_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+
+    if (ptr == NULL)
+    {
+        printf("Model: ::model_alloc Memory allocation failed");
+        exit(1);
+    }
+    return (ptr);
+}
+
+/* Round a file offset up to the next block boundary */
+static uint64_t model_align(uint64_t offset)
+{
+    return ((offset + LAYER_ALIGN - 1) & ~(uint64_t) (LAYER_ALIGN - 1));
+}
+
+/* Write zeros from offset from up to offset to */
+static int model_pad(FILE *fp, uint64_t from, uint64_t to)
+{
+    static const char zero[LAYER_ALIGN];
+
+    while (from < to)
+    {
+        size_t n = to - from < sizeof (zero) ? (size_t) (to - from) : sizeof (zero);
+
+        if (fwrite(zero, 1, n, fp) != n)
+        {
+            return (-1);
+        }
+        from += n;
+    }
+    return (0);
+}
@@ -0,0 +1,66 @@
+/*
+ * File: model.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ *
+ * Binary model file. A header, one record per layer and then the weight
+ * and threshold blocks, each starting on a LAYER_ALIGN boundary and laid
+ * out exactly as a layer holds them in memory. Loading maps the file and
+ * points the layers at the blocks, so nothing is parsed or copied and
+ * processes serving the same model share its pages. The pages are mapped
+ * private, training a loaded network copies only the pages it writes.
+ *
+ * Files are written in host byte order; the endian tag lets a reader on a
+ * machine of the other order refuse the file rather than misread it.
+ */
+#ifndef MODEL_H
+#define	MODEL_H
+
+#include <stdint.h>
+#include "ann.h"
+/* File identity */
+#define MODEL_MAGIC         "ANNM"
+#define MODEL_ENDIAN        0x01020304u
+#define MODEL_VERSION       1
+/* Sanity limit on the depth of a loaded network */
+#define MODEL_MAX_LAYERS    1024
+
+/* File header, padded to one alignment block */
+typedef struct
+{
+    char magic[4];
+    uint32_t endian;
+    uint32_t version;
+    uint32_t layer_count;
+    float learning_rate;
+    float accel_rate;
+    float slope;
+    uint32_t reserved;
+    uint64_t file_size;
+    uint8_t pad[24];
+} ModelHeader;
+
+/* Shape and parameter blocks of one layer, follows the header in order */
+typedef struct
+{
+    uint32_t count;
+    uint32_t input_count;
+    uint32_t stride;        /* Row pitch of the weight block in floats */
+    uint32_t activation;    /* ACTIVATION_ id */
+    float slope;
+    uint32_t reserved;
+    uint64_t weights;       /* File offset of count x stride floats */
+    uint64_t threshold;     /* File offset of count floats */
+    uint8_t pad[24];
+} ModelLayer;
+
+/* Prototypes */
+int model_save(const Ann * ann, const char *path);
+Ann * model_load(const char *path);
+/* Macros */
+#define AnnSave(this, path)         ((model_save)(this, path))
+#define AnnLoad(path)               ((model_load)(path))
+
+#endif	/* MODEL_H */
@@ -6,6 +6,9 @@
  * Created on: September 4, 2014, 9:30 AM
  */
 #include "neuron.h"
+#include "layer.h"
+#include "kernel.h"
+#include "random.h"
 
 /* Prototypes */
 static void neuron_destruct(Neuron *this);
@@ -16,65 +19,91 @@ static void neuron_adjust_threshold(Neuron *this, Msg *msg);
 static void neuron_get(Neuron *this, int attr, Msg *msg);
 static void neuron_set(Neuron *this, int attr, Msg *msg);
 static void neuron_print(Neuron *this);
-static float sigmoid(Neuron *this, float x);
-static float rnd(float max);
 
 /* Globals */
 static int inst_cnt;
 
-/* Instantiate a new object */
+/* Instantiate a new object. A standalone neuron is a view onto a private one
+ * row layer, destroying the neuron releases the layer. */
 Neuron * neuron_construct(int inputCnt, float slope)
 {
-    int i;
+    Layer *layer;
     Neuron *this = NULL;
-    /* Allocate memory */
-    this = (Neuron *) malloc(sizeof (Neuron));
-    if (this == NULL)
-    {
-        printf("rclass: ::neuron_construct Memory allocation failed");
-        exit(1);
-    }
+
+    layer = LayerNew(1, inputCnt, slope);
+    this = &layer->neurons[0];
+    this->stateFlag |= NEURON_OWNER;
+
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Initialise a neuron as a view onto row index of layer */
+void neuron_view_init(Neuron *this, Layer *layer, int index)
+{
+    int i;
+
     /* increment the instance count */
     inst_cnt++;
     /* Set initial values for data members */
     this->cls = NEURON;
-    this->inputCnt = inputCnt;
-    this->slope = slope;
-    this->threshold = rnd(1);
-    this->tchange = 0;
-    this->desired = 0;
-    this->error = 0;
-    this->active = 0;
-    this->output = 0;
+    this->inputCnt = layer->inputCnt;
+    this->slope = layer->slope;
+    this->layer = layer;
+    this->index = index;
+    this->weights = LayerRow(layer, weights, index);
+    this->wchange = LayerRow(layer, wchange, index);
     this->stateFlag = 0;
     this->id = inst_cnt;
     /* Add the dispatcher pointer */
     this->dispatcher = (void *) neuron_dispatcher;
-    for (i = 0; i < NEURON_SIZE; i++)
+    NeuronField(this, tchange) = 0;
+    NeuronField(this, desired) = 0;
+    NeuronField(this, error) = 0;
+    NeuronField(this, active) = 0;
+    NeuronField(this, output) = 0;
+    for (i = 0; i < this->inputCnt; i++)
     {
-        this->weights[i] = rnd(0.5);
-        this->inputs[i] = 0;
         this->wchange[i] = 0;
     }
+}
 
-    /* Return a pointer to the new object */
-    return (this);
+/* Random starting weights and threshold from the thread generator */
+void neuron_randomize(Neuron *this)
+{
+    Random *random = random_thread();
+
+    NeuronField(this, threshold) = random_uniform(random);
+    random_fill(random, this->weights, this->inputCnt, 0, 0.5f);
 }
 
-/* Do any clean up needed and free the memory */
+/* Do any clean up needed. Views are released with their layer */
 static void neuron_destruct(Neuron *this)
 {
-    /* Destruct super class/s first */
-    free(this);
+    if (this->stateFlag & NEURON_OWNER)
+    {
+        /* Releasing the private layer destroys this view */
+        this->stateFlag &= ~NEURON_OWNER;
+        LayerDestroy(this->layer);
+        return;
+    }
     inst_cnt--;
 }
 
 static void neuron_get(Neuron *this, int attr, Msg *msg)
 {
+    int i;
+
     switch (attr)
     {
-    case(NEURON_INPUT): msg->inputs = this->inputs;
+    case(NEURON_INPUT):
+    {
+        for (i = 0; i < this->inputCnt; i++)
+        {
+            msg->inputs[i] = this->layer->input[i];
+        }
         break;
+    }
         //case(NEURON_OUTPUT): msg->output = this->output;
         //break;
     /* Else print an error message or set an error flag */
@@ -84,42 +113,41 @@ static void neuron_get(Neuron *this, int attr, Msg *msg)
 
 static void neuron_set(Neuron *this, int attr, Msg *msg)
 {
-    int i;
-    
     switch (attr)
     {
-    case(NEURON_INPUT):
-    {
-        for (i = 0; i < this->inputCnt; i++)
-        {
-            this->inputs[i] = msg->inputs[i] ? msg->inputs[i] : rnd(0.1);
-        }
+    case(NEURON_INPUT): neuron_load_inputs(this, msg->inputs);
         break;
-    }
-    case(NEURON_DESIRED): this->desired = msg->desired;
+    case(NEURON_DESIRED): NeuronField(this, desired) = msg->desired;
         break;
     case(NEURON_SLOPE): this->slope = msg->slope;
         break;
-    case(NEURON_THRESHOLD): this->threshold = msg->threshold;
+    case(NEURON_THRESHOLD): NeuronField(this, threshold) = msg->threshold;
         break;
     /* Else print an error message or set an error flag */
     default: printf("rclass: ::_set: Unknown attribute %d\n", attr);
     }
 }
 
-static void neuron_calc_output(Neuron *this)
+/* Stage inputCnt inputs for the layer of this neuron, zero inputs are
+ * replaced with noise. Every neuron of the layer reads the staged vector,
+ * so one call serves them all. */
+void neuron_load_inputs(Neuron *this, const float *inputs)
 {
     int i;
-    float sum;
+    Layer *layer = this->layer;
+    Random *random = random_thread();
 
-    /* weights * inputCnt - threshold */
-    sum = 0;
     for (i = 0; i < this->inputCnt; i++)
     {
-        sum += this->weights[i] * this->inputs[i];
+        layer->staged[i] = inputs[i] ? inputs[i] : 0.1f * random_uniform(random);
     }
-    this->output = sum - this->threshold;
-    this->active = sigmoid(this, this->output);
+    layer->input = layer->staged;
+}
+
+/* The methods below wrap the direct calls in layer.h */
+static void neuron_calc_output(Neuron *this)
+{
+    neuron_output(this);
 }
 
 static void neuron_calc_error(Neuron *this, Msg *msg)
@@ -127,55 +155,23 @@ static void neuron_calc_error(Neuron *this, Msg *msg)
     /* Output layer error */
     if (msg->desired)
     {
-        this->error = (msg->desired - this->active) * this->active * (1 - this->active);
-        this->desired = msg->desired;
+        msg->error = neuron_output_error(this, msg->desired);
     }
         /* Hidden and input layer errors */
     else
     {
-        this->error = this->active * (1 - this->active) * msg->sum;
+        msg->error = neuron_hidden_error(this, msg->sum);
     }
-    msg->error = this->error;
 }
 
 static void neuron_adjust_weights(Neuron *this, Msg *msg)
 {
-    int i;
-
-    for (i = 0; i < this->inputCnt; i++)
-    {
-        /* LR * error * input + $ACL * lastChange */
-        this->wchange[i] = msg->LR * this->error * this->inputs[i] + msg->ACL * this->wchange[i];
-        this->weights[i] += this->wchange[i];
-    }
+    neuron_weights_step(this, msg->LR, msg->ACL);
 }
 
 static void neuron_adjust_threshold(Neuron *this, Msg *msg)
 {
-    /* LR * error * 1 + ACL * lastChange */
-    this->tchange = msg->LR * this->error * 1 + msg->ACL * this->tchange;
-    this->threshold -= this->tchange;
-}
-
-static float sigmoid(Neuron *this, float x)
-{
-    int y;
-    /* limits output range 0 to +1 */
-    if (x > 45)
-    {
-        return 1;
-    }
-        /* Avoids floating point overflow */
-    else if (x < -45)
-    {
-        return 0;
-    }
-    else
-    {
-        /* y = 2 / (1 + log(-2 * x)) - 1; -1 to 1 */
-        y = 1 / (1 + log(this->slope * x)); /* 0 to 1 */
-        return y;
-    }
+    neuron_threshold_step(this, msg->LR, msg->ACL);
 }
 
 static void neuron_print(Neuron *this)
@@ -184,12 +180,13 @@ static void neuron_print(Neuron *this)
     /* If this is a derived class send the message to its supercls first */
     //BaseClassPrint(this, attr, msg);
     printf("id = %d Slope = %f Active = %f Desired = %f Error = %f InputCnt = %d Output = %f\n stateFlag = %d tchange = %f Threshold = %f\n",
-           this->id, this->slope, this->active, this->desired, this->error, this->inputCnt,
-           this->output, this->stateFlag, this->tchange, this->threshold);
+           this->id, this->slope, NeuronField(this, active), NeuronField(this, desired),
+           NeuronField(this, error), this->inputCnt, NeuronField(this, output), this->stateFlag,
+           NeuronField(this, tchange), NeuronField(this, threshold));
 
     for (i = 0; i < this->inputCnt; i++)
     {
-        printf("inputs %d, weights %f, wchange %f\n", this->inputs[i], this->weights[i], this->wchange[i]);
+        printf("inputs %f, weights %f, wchange %f\n", this->layer->input[i], this->weights[i], this->wchange[i]);
     }
 }
 
@@ -217,18 +214,3 @@ void neuron_dispatcher(Neuron *this, int mthd, int attr, Msg *msg)
     default: printf("rclass: ::neuron_dispatcher: Unknown method %d\n", mthd);
     }
 }
-
-/* return a random number between 0 and limit inclusive. */
-static float rnd(float max)
-{
-    float divisor = RAND_MAX / (max + 1);
-    float retval;
-
-    do
-    {
-        retval = rand() / divisor;
-    }
-    while (retval > max);
-
-    return retval;
-}
@@ -32,19 +32,20 @@
 #define NEURON_DESIRED      NEURON + 15
 #define NEURON_ERROR        NEURON + 16
 #define NEURON_WEIGHTS      NEURON + 17
-/* Other */
-#define NEURON_SIZE         10
+/* State flags */
+#define NEURON_OWNER        0x01    /* Standalone, owns its private layer */
 /* Forward declarations */
 typedef struct _Msg Msg;
 typedef struct _Neuron Neuron;
+typedef struct _Layer Layer;
 
 struct _Msg
 {
     int inputCnt;
-    int *inputs;
+    float *inputs;
     float slope;
     float threshold;
-    float output[NEURON_SIZE];
+    float *output;      /* Caller supplied, one per output neuron */
     //float desired_out;
     float desired;
     float test_pattern;
@@ -53,6 +54,12 @@ struct _Msg
     float weight;
     float LR;
     float ACL;
+    int batch_size;
+    int thread_count;
+    int layer;          /* Layer index, 0 is the input layer */
+    int activation;
+    int profile;        /* ANN_PROFILE on or off */
+    int optimiser;      /* ANN_OPTIMISER rule, OPTIM_ in optim.h */
 };
 
 /* If this class is using multiple inheritance; add the class ID and use a
@@ -61,16 +68,13 @@ struct _Neuron
 {
     int cls;
     int inputCnt;
-    int inputs[NEURON_SIZE];
     float slope;
-    float threshold;
-    float weights[NEURON_SIZE];
-    float wchange[NEURON_SIZE];
-    float tchange;
-    float desired;
-    float error;
-    float active;
-    float output;
+    float *weights;     /* Row of the layer weight matrix */
+    float *wchange;     /* Row of the layer momentum matrix */
+    /* Scalar state (threshold, error, active...) lives in the layer vectors,
+     * use NeuronField(this, member) to reach it */
+    Layer *layer;
+    int index;          /* Row of this neuron within layer */
     /* extension */
     int stateFlag;
     int id;
@@ -79,6 +83,9 @@ struct _Neuron
 
 /* Prototypes */
 Neuron * neuron_construct(int inputCnt, float slope);
+void neuron_view_init(Neuron * this, Layer * layer, int index);
+void neuron_randomize(Neuron * this);
+void neuron_load_inputs(Neuron * this, const float *inputs);
 void neuron_dispatcher(Neuron * this, int mthd, int attr, Msg * msg);
 /* Required for multiple inheritance */
 //void DoSuperMethod(int cls, Neuron * this, int mthd, int attr, Msg * msg);
@@ -92,6 +99,7 @@ void neuron_dispatcher(Neuron * this, int mthd, int attr, Msg * msg);
 #define NeuronAdjustWeights(this, msg)      ((this->dispatcher)(this, ADJUST_WEIGHTS,   0,      msg))
 #define NeuronAdjustThreshold(this, msg)    ((this->dispatcher)(this, ADJUST_THRESHOLD, 0,      msg))
 #define NeuronPrint(this)                   ((this->dispatcher)(this, PRINT,            0,      NULL))
+#define NeuronField(this, member)           ((this)->layer->member[(this)->index])
 
 
 #endif	/* NEURON_H */
@@ -0,0 +1,150 @@
+/*
+ * File: optim.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include <string.h>
+#include "optim.h"
+#include "kernel.h"
+
+/* Globals */
+static const char *rule_names[OPTIM_RULES] = {"momentum", "nesterov", "rmsprop", "adam"};
+/* Floating point operations per parameter of each rule */
+static const double rule_flops[OPTIM_RULES] = {4, 6, 9, 13};
+
+/* Momentum with no state beyond the layers, as a network starts */
+void optim_init(Optimiser *this)
+{
+    this->rule = OPTIM_MOMENTUM;
+    this->beta1 = OPTIM_BETA1;
+    this->beta2 = OPTIM_BETA2;
+    this->epsilon = OPTIM_EPSILON;
+    this->step = 0;
+    this->square = NULL;
+    this->tsquare = NULL;
+    this->arena.base = NULL;
+}
+
+/* Switch to rule, clearing the moments of every layer */
+void optim_select(Optimiser *this, int rule, Layer **layers, int layer_count)
+{
+    int i;
+    size_t bytes;
+    Layer *layer;
+
+    optim_close(this);
+    this->rule = rule;
+    this->beta2 = rule == OPTIM_RMSPROP ? OPTIM_DECAY : OPTIM_BETA2;
+    for (i = 0; i < layer_count; i++)
+    {
+        layer = layers[i];
+        memset(layer->wchange, 0, (size_t) layer->count * layer->stride * sizeof (float));
+        memset(layer->tchange, 0, layer->count * sizeof (float));
+    }
+    if (rule != OPTIM_RMSPROP && rule != OPTIM_ADAM)
+    {
+        return;
+    }
+    /* The arena starts zeroed, so do the moments */
+    bytes = 2 * arena_round(layer_count * sizeof (float *));
+    for (i = 0; i < layer_count; i++)
+    {
+        bytes += arena_round((size_t) layers[i]->count * layers[i]->stride * sizeof (float))
+                + arena_round(layers[i]->count * sizeof (float));
+    }
+    arena_open(&this->arena, bytes);
+    this->square = arena_take(&this->arena, layer_count * sizeof (float *));
+    this->tsquare = arena_take(&this->arena, layer_count * sizeof (float *));
+    for (i = 0; i < layer_count; i++)
+    {
+        this->square[i] = arena_take(&this->arena,
+                                     (size_t) layers[i]->count * layers[i]->stride * sizeof (float));
+        this->tsquare[i] = arena_take(&this->arena, layers[i]->count * sizeof (float));
+    }
+}
+
+/* Drop the second moments, the rule is kept */
+void optim_close(Optimiser *this)
+{
+    arena_close(&this->arena);
+    this->square = NULL;
+    this->tsquare = NULL;
+    this->step = 0;
+}
+
+/* One step of every layer from the gradients summed over rows samples */
+void optim_update(Optimiser *this, Layer **layers, int layer_count, float **grad,
+                  float **tgrad, float rate, float accel, int rows)
+{
+    int i, n;
+    float scale = 1.0f / rows, mean = rate / rows;
+    Layer *layer;
+    const KernelOps *ops = kernel_ops;
+
+    this->step++;
+    /* Adam bias correction, folded into the rate */
+    if (this->rule == OPTIM_ADAM)
+    {
+        rate *= sqrt(1 - pow(this->beta2, this->step)) / (1 - pow(this->beta1, this->step));
+    }
+    for (i = 0; i < layer_count; i++)
+    {
+        layer = layers[i];
+        n = layer->count * layer->stride;
+        /* Thresholds move against the error, hence the negated scales.
+         * Every rule leaves tchange with the sign of the step added, the
+         * convention of momentum and the Msg path, velocity for nesterov
+         * and the first moment for adam */
+        switch (this->rule)
+        {
+        case(OPTIM_NESTEROV):
+            ops->nesterov(layer->weights, layer->wchange, grad[i], n, mean, accel);
+            ops->nesterov(layer->threshold, layer->tchange, tgrad[i], layer->count,
+                          -mean, accel);
+            break;
+        case(OPTIM_RMSPROP):
+            ops->rmsprop(layer->weights, this->square[i], grad[i], n, scale, rate,
+                         this->beta2, this->epsilon);
+            ops->rmsprop(layer->threshold, this->tsquare[i], tgrad[i], layer->count, -scale, rate,
+                         this->beta2, this->epsilon);
+            break;
+        case(OPTIM_ADAM):
+            ops->adam(layer->weights, layer->wchange, this->square[i], grad[i], n, scale, rate,
+                      this->beta1, this->beta2, this->epsilon);
+            ops->adam(layer->threshold, layer->tchange, this->tsquare[i], tgrad[i], layer->count,
+                      -scale, rate, this->beta1, this->beta2, this->epsilon);
+            break;
+        default:
+            ops->momentum(layer->weights, layer->wchange, grad[i], n, mean, accel);
+            ops->momentum(layer->threshold, layer->tchange, tgrad[i], layer->count,
+                          -mean, accel);
+        }
+    }
+}
+
+/* Rule called name, -1 if there is none */
+int optim_rule(const char *name)
+{
+    int i;
+
+    for (i = 0; i < OPTIM_RULES; i++)
+    {
+        if (strcmp(name, rule_names[i]) == 0)
+        {
+            return (i);
+        }
+    }
+    return (-1);
+}
+
+const char * optim_name(int rule)
+{
+    return (rule >= 0 && rule < OPTIM_RULES ? rule_names[rule] : "unknown");
+}
+
+double optim_flops(const Optimiser *this)
+{
+    return (rule_flops[this->rule]);
+}
@@ -0,0 +1,62 @@
+/*
+ * File: optim.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Update rules for the batched trainer, ann_train. Each rule is one fused
+ * kernel pass (kernel.h) over the weights of a layer and one over its
+ * thresholds, reading the mean gradient of the batch:
+ *
+ *   momentum  change = rate * g + accel * change, weights += change
+ *   nesterov  the same, the step looking ahead along the new change
+ *   rmsprop   weights scaled by the running RMS of their gradients
+ *   adam      bias corrected running mean over running RMS
+ *
+ * rate and accel are the learning_rate and accel_rate of the network.
+ * The first moment lives in the layer change matrices the momentum rules
+ * already use; the second moment of RMSProp and Adam is held here, one
+ * contiguous buffer per layer carved from an arena opened when such a rule
+ * is picked. Switching rules starts the state afresh. The per sample Msg
+ * path keeps the momentum step of the neurons whatever the rule.
+ */
+#ifndef OPTIM_H
+#define	OPTIM_H
+
+#include "layer.h"
+/* Rules */
+#define OPTIM_MOMENTUM      0
+#define OPTIM_NESTEROV      1
+#define OPTIM_RMSPROP       2
+#define OPTIM_ADAM          3
+#define OPTIM_RULES         4
+/* Defaults */
+#define OPTIM_BETA1         0.9f    /* Adam first moment */
+#define OPTIM_BETA2         0.999f  /* Adam second moment */
+#define OPTIM_DECAY         0.9f    /* RMSProp second moment */
+#define OPTIM_EPSILON       1e-8f
+
+typedef struct
+{
+    int rule;           /* OPTIM_ */
+    float beta1;
+    float beta2;        /* Decay of the second moment, RMSProp too */
+    float epsilon;
+    long step;          /* Updates made, for the Adam bias correction */
+    float **square;     /* count x stride per layer, NULL for momentum rules */
+    float **tsquare;    /* count per layer */
+    Arena arena;        /* square and tsquare, closed for momentum rules */
+} Optimiser;
+
+/* Prototypes */
+void optim_init(Optimiser * this);
+void optim_select(Optimiser * this, int rule, Layer ** layers, int layer_count);
+void optim_close(Optimiser * this);
+void optim_update(Optimiser * this, Layer ** layers, int layer_count, float **grad,
+                  float **tgrad, float rate, float accel, int rows);
+int optim_rule(const char *name);
+const char * optim_name(int rule);
+double optim_flops(const Optimiser * this);
+
+#endif	/* OPTIM_H */
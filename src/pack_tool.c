@@ -0,0 +1,46 @@
+/*
+ * File: pack_tool.c
+ * Program: ann_pack
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Converts a CSV data set to the packed binary format of dataset.h, which
+ * ann -t and the other tools read faster and can shuffle from the first
+ * epoch. Lines that do not hold inputs + outputs numbers are skipped, as
+ * the CSV reader skips them. Reports the rows written.
+ *
+ * Usage: ann_pack csv packed inputs outputs
+ * inputs and outputs are the input and target values of each row, the
+ * input_count and output_count of the network it is to train.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "dataset.h"
+
+int main(int argc, char *argv[])
+{
+    int inputs, outputs;
+    FILE *fp;
+    DatasetHeader head;
+
+    if (argc != 5 || (inputs = atoi(argv[3])) < 1 || (outputs = atoi(argv[4])) < 1)
+    {
+        fprintf(stderr, "Usage: %s csv packed inputs outputs\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+    if (DatasetPack(argv[1], argv[2], inputs, outputs) != 0)
+    {
+        return (EXIT_FAILURE);
+    }
+    fp = fopen(argv[2], "rb");
+    if (fp == NULL || fread(&head, sizeof (head), 1, fp) != 1)
+    {
+        fprintf(stderr, "ann_pack: Cannot read back %s\n", argv[2]);
+        return (EXIT_FAILURE);
+    }
+    fclose(fp);
+    printf("%llu rows of %d inputs and %d targets written to %s\n",
+           (unsigned long long) head.rows, inputs, outputs, argv[2]);
+    return (EXIT_SUCCESS);
+}
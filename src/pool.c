@@ -0,0 +1,157 @@
+/*
+ * File: pool.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ */
+#include "pool.h"
+
+/* Prototypes */
+static void pool_destruct(Pool *this);
+static void * pool_worker(void *arg);
+
+/* Worker start up, the pool and the workers id */
+typedef struct
+{
+    Pool *pool;
+    int id;
+} PoolSeat;
+
+/* Instantiate a new object */
+Pool * pool_construct(int count)
+{
+    int i;
+    PoolSeat *seat;
+    Pool *this = NULL;
+    /* Allocate memory */
+    this = (Pool *) malloc(sizeof (Pool));
+    if (this == NULL)
+    {
+        printf("Pool: ::pool_construct Memory allocation failed");
+        exit(1);
+    }
+    /* Set initial values for data members */
+    this->cls = POOL;
+    this->count = count > 0 ? count : 1;
+    this->generation = 0;
+    this->pending = 0;
+    this->quit = 0;
+    this->job = NULL;
+    this->arg = NULL;
+    this->dispatcher = (void *) pool_dispatcher; /* Add the dispatcher pointer */
+    pthread_mutex_init(&this->lock, NULL);
+    pthread_cond_init(&this->start, NULL);
+    pthread_cond_init(&this->done, NULL);
+    this->threads = malloc(this->count * sizeof (pthread_t));
+    if (this->threads == NULL)
+    {
+        printf("Pool: ::pool_construct Memory allocation failed");
+        exit(1);
+    }
+    /* Worker 0 is whoever calls pool_run */
+    for (i = 1; i < this->count; i++)
+    {
+        seat = malloc(sizeof (PoolSeat));
+        if (seat == NULL)
+        {
+            printf("Pool: ::pool_construct Memory allocation failed");
+            exit(1);
+        }
+        seat->pool = this;
+        seat->id = i;
+        if (pthread_create(&this->threads[i], NULL, pool_worker, seat) != 0)
+        {
+            printf("Pool: ::pool_construct Thread creation failed");
+            exit(1);
+        }
+    }
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Stop and join the workers, then free the memory */
+static void pool_destruct(Pool *this)
+{
+    int i;
+
+    pthread_mutex_lock(&this->lock);
+    this->quit = 1;
+    pthread_cond_broadcast(&this->start);
+    pthread_mutex_unlock(&this->lock);
+    for (i = 1; i < this->count; i++)
+    {
+        pthread_join(this->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&this->lock);
+    pthread_cond_destroy(&this->start);
+    pthread_cond_destroy(&this->done);
+    free(this->threads);
+    free(this);
+}
+
+/* Run job on every worker and return once they have all finished */
+void pool_run(Pool *this, PoolJob job, void *arg)
+{
+    pthread_mutex_lock(&this->lock);
+    this->job = job;
+    this->arg = arg;
+    this->pending = this->count - 1;
+    this->generation++;
+    pthread_cond_broadcast(&this->start);
+    pthread_mutex_unlock(&this->lock);
+
+    job(arg, 0, this->count);
+
+    pthread_mutex_lock(&this->lock);
+    while (this->pending > 0)
+    {
+        pthread_cond_wait(&this->done, &this->lock);
+    }
+    pthread_mutex_unlock(&this->lock);
+}
+
+static void * pool_worker(void *arg)
+{
+    PoolSeat *seat = arg;
+    Pool *this = seat->pool;
+    int id = seat->id;
+    unsigned long seen = 0;
+
+    free(seat);
+    pthread_mutex_lock(&this->lock);
+    for (;;)
+    {
+        while (!this->quit && this->generation == seen)
+        {
+            pthread_cond_wait(&this->start, &this->lock);
+        }
+        if (this->quit)
+        {
+            break;
+        }
+        seen = this->generation;
+        pthread_mutex_unlock(&this->lock);
+
+        this->job(this->arg, id, this->count);
+
+        pthread_mutex_lock(&this->lock);
+        if (--this->pending == 0)
+        {
+            pthread_cond_signal(&this->done);
+        }
+    }
+    pthread_mutex_unlock(&this->lock);
+    return (NULL);
+}
+
+void pool_dispatcher(Pool *this, int mthd, int attr, void *msg)
+{
+    switch (mthd)
+    {
+    case(POOL_DESTROY): pool_destruct(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Pool: ::pool_dispatcher: Unknown method %d\n", mthd);
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * File: pool.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ *
+ * A fixed set of worker threads that all run the same job and then wait
+ * for the next one. The calling thread takes part as worker 0.
+ */
+#ifndef POOL_H
+#define	POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+/* Class Id */
+#define POOL                (('P'+'O'+'O'+'L') << 16)
+/* Methods */
+#define POOL_DESTROY        POOL + 1
+
+/* Forward declarations */
+typedef struct _Pool Pool;
+/* Job run by every worker, id counts from 0 to count - 1 */
+typedef void (*PoolJob)(void *arg, int id, int count);
+
+struct _Pool
+{
+    int cls;
+    int count;                  /* Workers, including the caller */
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;   /* Bumped for every job */
+    int pending;                /* Workers still running the job */
+    int quit;
+    PoolJob job;
+    void *arg;
+    void (*dispatcher)(Pool * this, int mthd, int attr, void * msg);
+};
+
+/* Prototypes */
+Pool * pool_construct(int count);
+void pool_dispatcher(Pool * this, int mthd, int attr, void * msg);
+void pool_run(Pool * this, PoolJob job, void * arg);
+/* Macros */
+#define PoolNew(count)                      ((pool_construct)(count))
+#define PoolDestroy(this)                   ((this->dispatcher)(this, POOL_DESTROY, 0, NULL))
+#define PoolRun(this, job, arg)             ((pool_run)(this, job, arg))
+
+#endif	/* POOL_H */
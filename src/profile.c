@@ -0,0 +1,161 @@
+/*
+ * File: profile.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include <string.h>
+#include "profile.h"
+
+/* Prototypes */
+static void profile_destruct(Profile *this);
+static void profile_reset(Profile *this);
+static double profile_tick_rate(void);
+static double now(void);
+
+/* Globals */
+static const char *phase_names[PROFILE_PHASES] = {
+    "forward_input", "forward_hidden", "forward_output", "output_errors", "hidden_errors",
+    "train_input", "train_hidden", "train_output", "batch_forward", "batch_train",
+    "batch_reduce", "batch_update", "infer", "predict"
+};
+
+/* Instantiate a new object */
+Profile * profile_construct(void)
+{
+    Profile *this = NULL;
+    /* Allocate memory */
+    this = (Profile *) malloc(sizeof (Profile));
+    if (this == NULL)
+    {
+        printf("Profile: ::profile_construct Memory allocation failed");
+        exit(1);
+    }
+    /* Set initial values for data members */
+    this->cls = PROFILE;
+    this->epochs = NULL;
+    this->epoch_cap = 0;
+    this->tick_rate = profile_tick_rate();
+    this->dispatcher = (void *) profile_dispatcher; /* Add the dispatcher pointer */
+    profile_reset(this);
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Do any clean up needed and free the memory */
+static void profile_destruct(Profile *this)
+{
+    free(this->epochs);
+    free(this);
+}
+
+/* Zero every counter and forget the epochs */
+static void profile_reset(Profile *this)
+{
+    memset(this->phase, 0, sizeof (this->phase));
+    this->epoch_count = 0;
+    this->epoch_samples = 0;
+    this->epoch_seconds = 0;
+}
+
+/* Close an epoch, samples and seconds are the training totals so far */
+void profile_epoch(Profile *this, long samples, double seconds, float rms_error)
+{
+    ProfileEpoch *e;
+
+    if (this->epoch_count == this->epoch_cap)
+    {
+        this->epoch_cap = this->epoch_cap ? this->epoch_cap * 2 : 16;
+        this->epochs = realloc(this->epochs, this->epoch_cap * sizeof (ProfileEpoch));
+        if (this->epochs == NULL)
+        {
+            printf("Profile: ::profile_epoch Memory allocation failed");
+            exit(1);
+        }
+    }
+    e = &this->epochs[this->epoch_count++];
+    e->samples = samples - this->epoch_samples;
+    e->seconds = seconds - this->epoch_seconds;
+    e->rms_error = rms_error;
+    this->epoch_samples = samples;
+    this->epoch_seconds = seconds;
+}
+
+/* Every phase that ran and every epoch, as one JSON object */
+void profile_json(const Profile *this, FILE *fp)
+{
+    int i, first = 1;
+    const ProfileCounter *c;
+    double seconds;
+
+    fprintf(fp, "{\n  \"tick_rate\": %.0f,\n  \"phases\": [\n", this->tick_rate);
+    for (i = 0; i < PROFILE_PHASES; i++)
+    {
+        c = &this->phase[i];
+        if (c->calls == 0)
+        {
+            continue;
+        }
+        seconds = c->ticks / this->tick_rate;
+        fprintf(fp, "%s    {\"phase\": \"%s\", \"calls\": %llu, \"ticks\": %llu, \"seconds\": %.6f, "
+                "\"flops\": %llu, \"gflops\": %.3f, \"ticks_per_call\": %.1f}",
+                first ? "" : ",\n", phase_names[i], (unsigned long long) c->calls,
+                (unsigned long long) c->ticks, seconds, (unsigned long long) c->flops,
+                seconds > 0 ? c->flops / seconds * 1e-9 : 0.0, (double) c->ticks / c->calls);
+        first = 0;
+    }
+    fprintf(fp, "\n  ],\n  \"epochs\": [\n");
+    for (i = 0; i < this->epoch_count; i++)
+    {
+        fprintf(fp, "%s    {\"epoch\": %d, \"samples\": %ld, \"seconds\": %.6f, \"rms_error\": %.6f}",
+                i ? ",\n" : "", i + 1, this->epochs[i].samples, this->epochs[i].seconds,
+                this->epochs[i].rms_error);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+}
+
+const char * profile_name(int phase)
+{
+    return (phase >= 0 && phase < PROFILE_PHASES ? phase_names[phase] : "unknown");
+}
+
+/* Ticks per second, timed against the clock over a few milliseconds */
+static double profile_tick_rate(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    double t0, t1;
+    uint64_t c0, c1;
+    struct timespec pause = {0, 5000000};
+
+    t0 = now();
+    c0 = profile_ticks();
+    nanosleep(&pause, NULL);
+    t1 = now();
+    c1 = profile_ticks();
+    return ((c1 - c0) / (t1 - t0));
+#else
+    return (1e9);
+#endif
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+void profile_dispatcher(Profile *this, int mthd, int attr, void *msg)
+{
+    switch (mthd)
+    {
+    case(PROFILE_DESTROY): profile_destruct(this);
+        break;
+    case(PROFILE_RESET): profile_reset(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Profile: ::profile_dispatcher: Unknown method %d\n", mthd);
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * File: profile.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Opt in counters of where a network spends its time. Each phase counts
+ * calls, timer ticks (the TSC on x86, nanoseconds elsewhere) and floating
+ * point operations; epochs record the samples trained and the RMS error
+ * over them. A network has no Profile until profiling is switched on with
+ * ANN_PROFILE or the ANN_PROFILE environment variable, and every hook is
+ * then a single test of a NULL pointer.
+ *
+ * Counters are updated with relaxed atomic adds so threads scoring through
+ * ann_infer at once all count. The batched phases are timed around the
+ * whole job on the calling thread. The per layer phases are timed on
+ * whichever thread runs the layer: on the Msg path for every AnnRun, and
+ * for each thread's shard of a batch in ann_forward_batch, ann_infer and
+ * ann_train. In a batch the train phases time the gradient of each layer;
+ * batch_update times the update of all layers together. FLOPs count a
+ * multiply and an add per weight, as ann_bench does.
+ */
+#ifndef PROFILE_H
+#define	PROFILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+/* Class Id */
+#define PROFILE             (('P'+'R'+'O'+'F'+'I'+'L'+'E') << 16)
+/* Methods */
+#define PROFILE_DESTROY     PROFILE + 1
+#define PROFILE_RESET       PROFILE + 2
+/* Phases per layer */
+#define PROFILE_FORWARD_INPUT   0
+#define PROFILE_FORWARD_HIDDEN  1
+#define PROFILE_FORWARD_OUTPUT  2
+#define PROFILE_OUTPUT_ERRORS   3   /* Output layer deltas */
+#define PROFILE_HIDDEN_ERRORS   4   /* Errors carried back one layer */
+#define PROFILE_TRAIN_INPUT     5   /* Weight steps, or gradients, by layer */
+#define PROFILE_TRAIN_HIDDEN    6
+#define PROFILE_TRAIN_OUTPUT    7
+/* and the batched calls */
+#define PROFILE_BATCH_FORWARD   8   /* ann_forward_batch */
+#define PROFILE_BATCH_TRAIN     9   /* Forward and backward of each batch */
+#define PROFILE_BATCH_REDUCE    10  /* Gradient tree */
+#define PROFILE_BATCH_UPDATE    11  /* Momentum step of each batch */
+#define PROFILE_INFER           12
+#define PROFILE_PREDICT         13
+#define PROFILE_PHASES          14
+
+/* Forward declarations */
+typedef struct _Profile Profile;
+
+typedef struct
+{
+    uint64_t calls;
+    uint64_t ticks;
+    uint64_t flops;
+} ProfileCounter;
+
+typedef struct
+{
+    long samples;       /* Trained in the epoch */
+    float rms_error;    /* Over the epoch */
+    double seconds;     /* Training time in the epoch */
+} ProfileEpoch;
+
+struct _Profile
+{
+    int cls;
+    ProfileCounter phase[PROFILE_PHASES];
+    double tick_rate;   /* Ticks per second */
+    /* Epochs, grown as they end */
+    int epoch_count;
+    int epoch_cap;
+    ProfileEpoch *epochs;
+    long epoch_samples; /* Training totals when the last epoch ended */
+    double epoch_seconds;
+    void (*dispatcher)(Profile * this, int mthd, int attr, void * msg);
+};
+
+/* Prototypes */
+Profile * profile_construct(void);
+void profile_dispatcher(Profile * this, int mthd, int attr, void * msg);
+void profile_epoch(Profile * this, long samples, double seconds, float rms_error);
+void profile_json(const Profile * this, FILE * fp);
+const char * profile_name(int phase);
+/* Macros */
+#define ProfileNew()                        ((profile_construct)())
+#define ProfileDestroy(this)                ((this->dispatcher)(this, PROFILE_DESTROY, 0, NULL))
+#define ProfileReset(this)                  ((this->dispatcher)(this, PROFILE_RESET,   0, NULL))
+#define ProfileJson(this, fp)               ((profile_json)(this, fp))
+
+/* Timer in ticks */
+static inline uint64_t profile_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (__rdtsc());
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec);
+#endif
+}
+
+/* Wall clock in seconds, for rates over a whole run */
+static inline double profile_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+/* Start of a phase, 0 when not profiling */
+static inline uint64_t profile_start(const Profile *this)
+{
+    return (this != NULL ? profile_ticks() : 0);
+}
+
+/* End of a phase begun at start */
+static inline void profile_stop(Profile *this, int phase, uint64_t start, double flops)
+{
+    ProfileCounter *c;
+
+    if (this == NULL)
+    {
+        return;
+    }
+    c = &this->phase[phase];
+    __atomic_fetch_add(&c->calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->ticks, profile_ticks() - start, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->flops, (uint64_t) flops, __ATOMIC_RELAXED);
+}
+
+#endif	/* PROFILE_H */
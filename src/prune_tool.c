@@ -0,0 +1,119 @@
+/*
+ * File: prune_tool.c
+ * Program: ann_prune
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * What magnitude pruning costs in accuracy and buys in speed. Loads a
+ * model file twice, prunes one copy by the share given and compiles it
+ * with SparseNew, then runs one pass of a validation set through the
+ * original and the pruned form and reports for each the RMS error against
+ * the targets, the share of samples classified as the target classifies
+ * them and the samples per second, along with the parameter memory of
+ * each and the form picked for every layer. The pruned network can be
+ * saved for fine tuning.
+ * The scoring pass and the classification are those of score.h.
+ *
+ * Usage: ann_prune [-d density] [-s model] model data share
+ * data is a CSV or packed data set as read by ann -t, share the part of
+ * the weights of each layer to prune, 0 to 1, and density the share of
+ * nonzero weights under which a layer is held sparse.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "ann.h"
+#include "model.h"
+#include "dataset.h"
+#include "sparse.h"
+#include "score.h"
+
+/* Prototypes */
+static void forward_sparse(void *sparse, const float *inputs, int rows, float *outputs);
+
+int main(int argc, char *argv[])
+{
+    Ann *ann, *pruned;
+    Sparse *sparse;
+    Dataset *data;
+    float density = SPARSE_DENSITY;
+    const char *save = NULL;
+    int opt, i;
+    long samples, zeroed;
+    Score forms[2];
+    const SparseLayer *s;
+
+    while ((opt = getopt(argc, argv, "d:s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd': density = atof(optarg);
+            break;
+        case 's': save = optarg;
+            break;
+        default: fprintf(stderr, "Usage: %s [-d density] [-s model] model data share\n", argv[0]);
+            return (EXIT_FAILURE);
+        }
+    }
+    if (argc - optind != 3)
+    {
+        fprintf(stderr, "Usage: %s [-d density] [-s model] model data share\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+    ann = AnnLoad(argv[optind]);
+    if (ann == NULL)
+    {
+        return (EXIT_FAILURE);
+    }
+    pruned = AnnLoad(argv[optind]);
+    data = DatasetNew(argv[optind + 1], ann->input_count, ann->output_count, 0, 1);
+    if (pruned == NULL || data == NULL)
+    {
+        if (pruned != NULL)
+        {
+            AnnDestroy(pruned);
+        }
+        AnnDestroy(ann);
+        return (EXIT_FAILURE);
+    }
+    zeroed = AnnPrune(pruned, atof(argv[optind + 2]));
+    if (save != NULL && AnnSave(pruned, save) != 0)
+    {
+        DatasetDestroy(data);
+        AnnDestroy(pruned);
+        AnnDestroy(ann);
+        return (EXIT_FAILURE);
+    }
+    sparse = SparseNewDensity(pruned, density);
+    score_init(&forms[0], "dense", ann, score_ann, score_ann_bytes(ann));
+    score_init(&forms[1], "pruned", sparse, forward_sparse, sparse->bytes);
+    samples = score_pass(forms, 2, data, ann->output_count);
+    if (samples == 0)
+    {
+        fprintf(stderr, "ann_prune: %s holds no samples\n", argv[optind + 1]);
+    }
+    else
+    {
+        printf("%ld weights pruned\n", zeroed);
+        for (i = 0; i < sparse->layer_count; i++)
+        {
+            s = &sparse->layers[i];
+            printf("Layer %d: %d x %d, density %.3f, %s\n", i, s->count, s->inputCnt,
+                   (double) s->nonzero / ((double) s->count * s->inputCnt),
+                   s->weights == NULL ? "sparse" : "dense");
+        }
+        score_report(forms, 2, samples);
+        printf("Accuracy drop %.3f%%\n", 100.0 * (forms[0].correct - forms[1].correct) / samples);
+    }
+    SparseDestroy(sparse);
+    DatasetDestroy(data);
+    AnnDestroy(pruned);
+    AnnDestroy(ann);
+    return (samples ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void forward_sparse(void *sparse, const float *inputs, int rows, float *outputs)
+{
+    SparseForward((Sparse *) sparse, inputs, rows, outputs);
+}
@@ -0,0 +1,180 @@
+/*
+ * File: quant.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include "quant.h"
+#include "kernel.h"
+
+/* Prototypes */
+static void quant_destruct(Quant *this);
+static void quant_layer(QuantLayer *q, const Layer *layer);
+static void quant_inputs(const float *x, int n, uint8_t *code, float *scale, int32_t *zero);
+
+/* Instantiate an 8 bit copy of ann, the network itself is not changed */
+Quant * quant_construct(const Ann *ann)
+{
+    int i, widest;
+    Quant *this = NULL;
+    /* Allocate memory */
+    this = (Quant *) malloc(sizeof (Quant));
+    if (this == NULL)
+    {
+        printf("Quant: ::quant_construct Memory allocation failed");
+        exit(1);
+    }
+    /* Set initial values for data members */
+    this->cls = QUANT;
+    this->input_count = ann->input_count;
+    this->output_count = ann->output_count;
+    this->layer_count = ann->layer_count;
+    this->dispatcher = (void *) quant_dispatcher; /* Add the dispatcher pointer */
+    this->layers = malloc(ann->layer_count * sizeof (QuantLayer));
+    if (this->layers == NULL)
+    {
+        printf("Quant: ::quant_construct Memory allocation failed");
+        exit(1);
+    }
+    this->bytes = 0;
+    widest = 1;
+    for (i = 0; i < ann->layer_count; i++)
+    {
+        quant_layer(&this->layers[i], ann->layers[i]);
+        this->bytes += (size_t) this->layers[i].count
+                * (this->layers[i].stride + sizeof (float) * 2 + sizeof (int32_t));
+        widest = this->layers[i].stride > widest ? this->layers[i].stride : widest;
+        widest = this->layers[i].count > widest ? this->layers[i].count : widest;
+    }
+    /* Codes are read a whole padded row at a time, keep the tail defined */
+    this->code = layer_alloc(widest);
+    memset(this->code, 0, widest);
+    this->act[0] = layer_alloc(widest * sizeof (float));
+    this->act[1] = layer_alloc(widest * sizeof (float));
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Round the parameters of layer into q, one scale per neuron */
+static void quant_layer(QuantLayer *q, const Layer *layer)
+{
+    int i, j;
+    float max, *row;
+    int8_t *codes;
+
+    q->count = layer->count;
+    q->inputCnt = layer->inputCnt;
+    q->stride = (layer->inputCnt + LAYER_ALIGN - 1) & ~(LAYER_ALIGN - 1);
+    q->activation = layer->activation;
+    q->slope = layer->slope;
+    q->weights = layer_alloc((size_t) q->count * q->stride);
+    q->scale = layer_alloc(q->count * sizeof (float));
+    q->rowsum = layer_alloc(q->count * sizeof (int32_t));
+    q->threshold = layer_alloc(q->count * sizeof (float));
+    memset(q->weights, 0, (size_t) q->count * q->stride);
+    memcpy(q->threshold, layer->threshold, q->count * sizeof (float));
+    for (i = 0; i < q->count; i++)
+    {
+        row = LayerRow(layer, weights, i);
+        codes = q->weights + (size_t) i * q->stride;
+        max = 0;
+        for (j = 0; j < q->inputCnt; j++)
+        {
+            max = fabsf(row[j]) > max ? fabsf(row[j]) : max;
+        }
+        q->scale[i] = max > 0 ? max / QUANT_MAX : 1;
+        q->rowsum[i] = 0;
+        for (j = 0; j < q->inputCnt; j++)
+        {
+            codes[j] = (int8_t) lrintf(row[j] / q->scale[i]);
+            q->rowsum[i] += codes[j];
+        }
+    }
+}
+
+/* Do any clean up needed and free the memory */
+static void quant_destruct(Quant *this)
+{
+    int i;
+
+    for (i = 0; i < this->layer_count; i++)
+    {
+        free(this->layers[i].weights);
+        free(this->layers[i].scale);
+        free(this->layers[i].rowsum);
+        free(this->layers[i].threshold);
+    }
+    free(this->layers);
+    free(this->code);
+    free(this->act[0]);
+    free(this->act[1]);
+    free(this);
+}
+
+/* Evaluate rows input vectors, inputs is rows x input_count and outputs
+ * rows x output_count, as ann_forward_batch does for the float network */
+void quant_forward(Quant *this, const float *inputs, int rows, float *outputs)
+{
+    int r, l, j;
+    int32_t zero;
+    float scale, *out;
+    const float *in;
+    const QuantLayer *q;
+    int32_t (*dot_u8)(const uint8_t *, const int8_t *, int) = kernel_ops->dot_u8;
+
+    for (r = 0; r < rows; r++)
+    {
+        in = inputs + (size_t) r * this->input_count;
+        for (l = 0; l < this->layer_count; l++)
+        {
+            q = &this->layers[l];
+            out = l == this->layer_count - 1 ? outputs + (size_t) r * this->output_count
+                    : this->act[l & 1];
+            quant_inputs(in, q->inputCnt, this->code, &scale, &zero);
+            /* Whole padded rows, the padding weights are zero */
+            for (j = 0; j < q->count; j++)
+            {
+                out[j] = q->scale[j] * scale
+                        * (float) (dot_u8(this->code, q->weights + (size_t) j * q->stride, q->stride)
+                                   - zero * q->rowsum[j]);
+            }
+            kernel_bias_activation(out, 1, q->count, q->count, q->threshold, q->slope, q->activation);
+            in = out;
+        }
+    }
+}
+
+/* Codes 0 to QUANT_MAX for x, x = scale * (code - zero). The range always
+ * takes in 0 so a zero input is exact. */
+static void quant_inputs(const float *x, int n, uint8_t *code, float *scale, int32_t *zero)
+{
+    int i;
+    long c;
+    float lo = 0, hi = 0, inv;
+
+    for (i = 0; i < n; i++)
+    {
+        lo = x[i] < lo ? x[i] : lo;
+        hi = x[i] > hi ? x[i] : hi;
+    }
+    *scale = hi > lo ? (hi - lo) / QUANT_MAX : 1;
+    *zero = (int32_t) lrintf(-lo / *scale);
+    inv = 1 / *scale;
+    for (i = 0; i < n; i++)
+    {
+        c = lrintf(x[i] * inv) + *zero;
+        code[i] = (uint8_t) (c < 0 ? 0 : c > QUANT_MAX ? QUANT_MAX : c);
+    }
+}
+
+void quant_dispatcher(Quant *this, int mthd, int attr, void *msg)
+{
+    switch (mthd)
+    {
+    case(QUANT_DESTROY): quant_destruct(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Quant: ::quant_dispatcher: Unknown method %d\n", mthd);
+    }
+}
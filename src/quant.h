@@ -0,0 +1,74 @@
+/*
+ * File: quant.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Post training 8 bit inference. QuantNew takes a trained network and
+ * rounds the weights of each neuron to int8 with a scale of its own,
+ * max |w| / 127, a quarter of the float memory. Thresholds stay float,
+ * they are one value per neuron and are added after the integer sum.
+ *
+ * Layer inputs are quantised on the fly, one scale and zero point per
+ * input vector, to unsigned codes 0 to QUANT_MAX. Keeping the codes to 7
+ * bits lets the AVX2 pmaddubsw pair sums run without saturating, so every
+ * kernel table, VNNI included, produces the same integer sum. With
+ *   x = sa * (q - z)   and   w = sw * c
+ * a neuron computes sw * sa * (sum(q * c) - z * sum(c)) - threshold, the
+ * sum(c) of each row taken once here. Activations are then applied in
+ * float by the same kernels as the float path.
+ */
+#ifndef QUANT_H
+#define	QUANT_H
+
+#include <stdint.h>
+#include "ann.h"
+/* Class Id */
+#define QUANT               (('Q'+'U'+'A'+'N'+'T') << 16)
+/* Methods */
+#define QUANT_DESTROY       QUANT + 1
+/* Largest input code and weight magnitude */
+#define QUANT_MAX           127
+
+/* One layer in 8 bit form */
+typedef struct
+{
+    int count;
+    int inputCnt;
+    int stride;         /* Row pitch in bytes, padded to LAYER_ALIGN */
+    int activation;
+    float slope;
+    int8_t *weights;    /* count x stride, padding zero */
+    float *scale;       /* count, weight scale of each row */
+    int32_t *rowsum;    /* count, sum of each row of codes */
+    float *threshold;   /* count */
+} QuantLayer;
+
+/* Forward declarations */
+typedef struct _Quant Quant;
+
+struct _Quant
+{
+    int cls;
+    int input_count;
+    int output_count;
+    int layer_count;
+    QuantLayer *layers;
+    size_t bytes;       /* Parameter memory of all layers */
+    /* Scratch for one sample, the object is not shared between threads */
+    uint8_t *code;      /* Quantised inputs of the layer being run */
+    float *act[2];      /* Activations, alternate layers */
+    void (*dispatcher)(Quant * this, int mthd, int attr, void * msg);
+};
+
+/* Prototypes */
+Quant * quant_construct(const Ann * ann);
+void quant_dispatcher(Quant * this, int mthd, int attr, void * msg);
+void quant_forward(Quant * this, const float *inputs, int rows, float *outputs);
+/* Macros */
+#define QuantNew(ann)                       ((quant_construct)(ann))
+#define QuantDestroy(this)                  ((this->dispatcher)(this, QUANT_DESTROY, 0, NULL))
+#define QuantForward(this, inputs, rows, outputs) ((quant_forward)(this, inputs, rows, outputs))
+
+#endif	/* QUANT_H */
@@ -0,0 +1,77 @@
+/*
+ * File: quant_tool.c
+ * Program: ann_quant
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * What 8 bit inference costs in accuracy and buys in speed. Loads a model
+ * file, quantises it and runs one pass of a validation set through both
+ * forms, then reports for each the RMS error against the targets, the
+ * share of samples classified as the target classifies them and the
+ * samples per second, along with the largest output difference between
+ * the two and the parameter memory of each.
+ * The scoring pass and the classification are those of score.h.
+ *
+ * Usage: ann_quant model data
+ * data is a CSV or packed data set as read by ann -t.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "ann.h"
+#include "model.h"
+#include "dataset.h"
+#include "quant.h"
+#include "score.h"
+
+/* Prototypes */
+static void forward_int8(void *quant, const float *inputs, int rows, float *outputs);
+
+int main(int argc, char *argv[])
+{
+    Ann *ann;
+    Quant *quant;
+    Dataset *data;
+    long samples;
+    Score forms[2];
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s model data\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+    ann = AnnLoad(argv[1]);
+    if (ann == NULL)
+    {
+        return (EXIT_FAILURE);
+    }
+    data = DatasetNew(argv[2], ann->input_count, ann->output_count, 0, 1);
+    if (data == NULL)
+    {
+        AnnDestroy(ann);
+        return (EXIT_FAILURE);
+    }
+    quant = QuantNew(ann);
+    score_init(&forms[0], "float", ann, score_ann, score_ann_bytes(ann));
+    score_init(&forms[1], "int8", quant, forward_int8, quant->bytes);
+    samples = score_pass(forms, 2, data, ann->output_count);
+    if (samples == 0)
+    {
+        fprintf(stderr, "ann_quant: %s holds no samples\n", argv[2]);
+    }
+    else
+    {
+        score_report(forms, 2, samples);
+        printf("Accuracy drop %.3f%%, largest output difference %f\n",
+               100.0 * (forms[0].correct - forms[1].correct) / samples, forms[1].max_diff);
+    }
+    QuantDestroy(quant);
+    DatasetDestroy(data);
+    AnnDestroy(ann);
+    return (samples ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void forward_int8(void *quant, const float *inputs, int rows, float *outputs)
+{
+    QuantForward((Quant *) quant, inputs, rows, outputs);
+}
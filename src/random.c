@@ -0,0 +1,114 @@
+/*
+ * File: random.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include "random.h"
+
+/* Prototypes */
+static uint64_t splitmix64(uint64_t *x);
+static inline uint64_t rotl(uint64_t x, int k);
+
+/* Globals */
+static uint64_t global_seed = RANDOM_DEFAULT_SEED;
+static int thread_streams;          /* Streams handed out so far */
+static __thread Random thread_random;
+static __thread int thread_seeded;
+
+/* Start this on stream of seed, each stream is its own sequence */
+void random_seed(Random *this, uint64_t seed, uint64_t stream)
+{
+    int w, k;
+    uint64_t x = seed ^ (stream * 0xd1b54a32d192ed03ULL);
+
+    for (k = 0; k < RANDOM_LANES; k++)
+    {
+        for (w = 0; w < 4; w++)
+        {
+            this->s[w][k] = splitmix64(&x);
+        }
+    }
+    this->next = RANDOM_LANES;
+}
+
+/* Step every lane once into out. Written lane by lane with multiplies by 5
+ * and 9 so it vectorises without 64 bit vector multiplies. */
+void random_block(Random *this)
+{
+    int k;
+    uint64_t t, r;
+
+    for (k = 0; k < RANDOM_LANES; k++)
+    {
+        r = this->s[1][k] + (this->s[1][k] << 2);
+        r = rotl(r, 7);
+        this->out[k] = r + (r << 3);
+        t = this->s[1][k] << 17;
+        this->s[2][k] ^= this->s[0][k];
+        this->s[3][k] ^= this->s[1][k];
+        this->s[1][k] ^= this->s[2][k];
+        this->s[0][k] ^= this->s[3][k];
+        this->s[2][k] ^= t;
+        this->s[3][k] = rotl(this->s[3][k], 45);
+    }
+    this->next = 0;
+}
+
+/* n values uniform over lo to hi, hi excluded, the same values n calls of
+ * random_uniform would give but taken a block at a time */
+void random_fill(Random *this, float *x, int n, float lo, float hi)
+{
+    int i = 0;
+    float scale = (hi - lo) * (1.0f / 16777216.0f);
+
+    while (i < n)
+    {
+        if (this->next == RANDOM_LANES)
+        {
+            random_block(this);
+        }
+        while (this->next < RANDOM_LANES && i < n)
+        {
+            x[i++] = lo + scale * (float) (uint32_t) (this->out[this->next++] >> 40);
+        }
+    }
+}
+
+/* Seed for every thread generator from now on, the calling thread restarts
+ * as stream 0 and the next thread to draw is stream 1. Threads that have
+ * drawn already keep their sequences. */
+void random_global_seed(uint64_t seed)
+{
+    global_seed = seed;
+    random_seed(&thread_random, seed, 0);
+    thread_seeded = 1;
+    __atomic_store_n(&thread_streams, 1, __ATOMIC_RELAXED);
+}
+
+/* Generator of the calling thread */
+Random * random_thread(void)
+{
+    if (!thread_seeded)
+    {
+        random_seed(&thread_random, global_seed,
+                    __atomic_fetch_add(&thread_streams, 1, __ATOMIC_RELAXED));
+        thread_seeded = 1;
+    }
+    return (&thread_random);
+}
+
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (z ^ (z >> 31));
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return ((x << k) | (x >> (64 - k)));
+}
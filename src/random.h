@@ -0,0 +1,69 @@
+/*
+ * File: random.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * xoshiro256** pseudo random numbers, replacing rand(). A generator is a
+ * plain struct with no locks; RANDOM_LANES independent xoshiro states are
+ * stepped side by side so a block of outputs is one loop the compiler can
+ * vectorise, and random_fill writes whole layers from those blocks.
+ *
+ * The output depends only on the seed and the stream number, lanes are
+ * seeded from them through splitmix64. Every thread has a generator of its
+ * own from random_thread(): the first thread to ask is stream 0, the next
+ * stream 1 and so on, all from the seed given to random_global_seed(). A
+ * program that seeds once before starting threads and draws from them in
+ * a fixed order therefore repeats exactly for a given seed and thread
+ * count. Generators that are not a thread's, like the shuffle of a
+ * Dataset, take a stream from the top of the range, clear of any thread.
+ */
+#ifndef RANDOM_H
+#define	RANDOM_H
+
+#include <stdint.h>
+/* xoshiro states stepped together */
+#define RANDOM_LANES        8
+/* Seed used until random_global_seed is called */
+#define RANDOM_DEFAULT_SEED 0x853c49e6748fea9bULL
+/* Streams outside the thread generators */
+#define RANDOM_STREAM_DATASET   (1ULL << 63)    /* Chunk shuffle */
+
+typedef struct
+{
+    uint64_t s[4][RANDOM_LANES];    /* Word w of lane k is s[w][k] */
+    uint64_t out[RANDOM_LANES];     /* Last block of outputs */
+    int next;                       /* Unread position in out */
+} Random;
+
+/* Prototypes */
+void random_seed(Random * this, uint64_t seed, uint64_t stream);
+void random_block(Random * this);
+void random_fill(Random * this, float *x, int n, float lo, float hi);
+void random_global_seed(uint64_t seed);
+Random * random_thread(void);
+
+/* Next 64 random bits */
+static inline uint64_t random_next(Random *this)
+{
+    if (this->next == RANDOM_LANES)
+    {
+        random_block(this);
+    }
+    return (this->out[this->next++]);
+}
+
+/* Uniform over 0 to 1, 1 excluded, from the top 24 bits */
+static inline float random_uniform(Random *this)
+{
+    return ((float) (random_next(this) >> 40) * (1.0f / 16777216.0f));
+}
+
+/* Uniform integer 0 to n - 1, by multiply and shift rather than modulo */
+static inline uint32_t random_below(Random *this, uint32_t n)
+{
+    return ((uint32_t) (((random_next(this) >> 32) * n) >> 32));
+}
+
+#endif	/* RANDOM_H */
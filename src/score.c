@@ -0,0 +1,132 @@
+/*
+ * File: score.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "score.h"
+#include "kernel.h"
+
+/* Prototypes */
+static void score_add(Score *this, const float *out, const float *targets, int rows, int n);
+
+/* A form with no totals yet */
+void score_init(Score *this, const char *name, void *model, ScoreForward forward, size_t bytes)
+{
+    this->name = name;
+    this->model = model;
+    this->forward = forward;
+    this->bytes = bytes;
+    this->sq_error = 0;
+    this->correct = 0;
+    this->seconds = 0;
+    this->max_diff = 0;
+}
+
+/* One epoch of data through every form, returns the samples read */
+long score_pass(Score *forms, int count, Dataset *data, int output_count)
+{
+    int rows, f, i;
+    long samples = 0;
+    size_t size;
+    float *out = NULL, diff;
+    const float *inputs, *targets;
+    double t0;
+
+    /* dataset_next reports the end of the epoch with 0 */
+    while ((rows = DatasetNext(data, &inputs, &targets)) > 0)
+    {
+        size = (size_t) rows * output_count;
+        out = realloc(out, count * size * sizeof (float));
+        if (out == NULL)
+        {
+            printf("Score: ::score_pass Memory allocation failed");
+            exit(1);
+        }
+        for (f = 0; f < count; f++)
+        {
+            t0 = profile_seconds();
+            forms[f].forward(forms[f].model, inputs, rows, out + f * size);
+            forms[f].seconds += profile_seconds() - t0;
+            score_add(&forms[f], out + f * size, targets, rows, output_count);
+            for (i = 0; i < (int) size; i++)
+            {
+                diff = fabsf(out[f * size + i] - out[i]);
+                forms[f].max_diff = diff > forms[f].max_diff ? diff : forms[f].max_diff;
+            }
+        }
+        samples += rows;
+    }
+    free(out);
+    return (samples);
+}
+
+/* The kernel table and a row of totals per form */
+void score_report(const Score *forms, int count, long samples)
+{
+    int f;
+
+    printf("Kernel %s, %ld samples\n", kernel_ops->name, samples);
+    printf("        %12s %10s %14s %12s\n", "RMS error", "accuracy", "samples/sec", "bytes");
+    for (f = 0; f < count; f++)
+    {
+        printf("%-7s %12.6f %9.3f%% %14.1f %12zu\n", forms[f].name,
+               sqrt(forms[f].sq_error / samples),
+               100.0 * forms[f].correct / samples, samples / forms[f].seconds, forms[f].bytes);
+    }
+}
+
+/* Add the squared error and the correct classifications of rows outputs */
+static void score_add(Score *this, const float *out, const float *targets, int rows, int n)
+{
+    int r, j;
+
+    for (r = 0; r < rows; r++)
+    {
+        for (j = 0; j < n; j++)
+        {
+            this->sq_error += (out[j] - targets[j]) * (out[j] - targets[j]);
+        }
+        this->correct += score_classify(out, n) == score_classify(targets, n);
+        out += n;
+        targets += n;
+    }
+}
+
+/* Class of one sample's n outputs */
+int score_classify(const float *out, int n)
+{
+    int j, best = 0;
+
+    if (n == 1)
+    {
+        return (out[0] > 0.5f);
+    }
+    for (j = 1; j < n; j++)
+    {
+        best = out[j] > out[best] ? j : best;
+    }
+    return (best);
+}
+
+/* The float network as a form */
+void score_ann(void *ann, const float *inputs, int rows, float *outputs)
+{
+    AnnForwardBatch((Ann *) ann, inputs, rows, outputs);
+}
+
+/* Parameter memory of the float network, weights and thresholds */
+size_t score_ann_bytes(const Ann *ann)
+{
+    int i;
+    size_t bytes = 0;
+
+    for (i = 0; i < ann->layer_count; i++)
+    {
+        bytes += (size_t) ann->layers[i]->count * (ann->layers[i]->stride + 1) * sizeof (float);
+    }
+    return (bytes);
+}
@@ -0,0 +1,50 @@
+/*
+ * File: score.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Accuracy and speed of several forms of one network over a data set, the
+ * pass behind the ann_quant and ann_prune reports. score_pass reads one
+ * epoch and runs every form on each chunk, timing each forward call on
+ * its own; score_report prints a row per form.
+ *
+ * The RMS error is the one ann -t and ann_epoch print: the squared errors
+ * of a sample's outputs are summed, averaged over the samples and rooted.
+ *
+ * A sample is classified by its largest output, or by output > 0.5 when
+ * the network has a single output, and counts as correct when it is
+ * classified as its target is.
+ */
+#ifndef SCORE_H
+#define	SCORE_H
+
+#include "ann.h"
+#include "dataset.h"
+
+/* rows outputs of model for rows inputs */
+typedef void (*ScoreForward)(void *model, const float *inputs, int rows, float *outputs);
+
+/* One form of the network and its totals over the set */
+typedef struct
+{
+    const char *name;   /* Row of the report */
+    void *model;
+    ScoreForward forward;
+    size_t bytes;       /* Parameter memory */
+    double sq_error;
+    long correct;
+    double seconds;
+    float max_diff;     /* Largest output difference from the first form */
+} Score;
+
+/* Prototypes */
+void score_init(Score * this, const char *name, void *model, ScoreForward forward, size_t bytes);
+long score_pass(Score * forms, int count, Dataset * data, int output_count);
+void score_report(const Score * forms, int count, long samples);
+int score_classify(const float *out, int n);
+void score_ann(void *ann, const float *inputs, int rows, float *outputs);
+size_t score_ann_bytes(const Ann * ann);
+
+#endif	/* SCORE_H */
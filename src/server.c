@@ -0,0 +1,580 @@
+/*
+ * File: server.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "server.h"
+
+/* Connection handed to its thread */
+typedef struct
+{
+    Server *server;
+    int fd;
+} ServerConnection;
+
+/* Prototypes */
+static void server_destruct(Server *this);
+static int server_socket(const char *address, int listening);
+static void * server_connection(void *arg);
+static void server_close(Server *this, int fd);
+static void * server_batcher(void *arg);
+static int server_bucket(uint64_t value);
+static uint64_t server_now(void);
+static void server_histogram(FILE *fp, const char *name, const long *counts, int n, int last);
+
+/* Instantiate a server of ann listening on address, NULL if the socket
+ * cannot be opened. Requests are answered once server_run is called. */
+Server * server_construct(Ann *ann, const char *address, int batch, long delay)
+{
+    int fd;
+    size_t bytes;
+    pthread_condattr_t attr;
+    Server *this = NULL;
+
+    fd = server_socket(address, 1);
+    if (fd < 0)
+    {
+        return (NULL);
+    }
+    /* Allocate memory */
+    this = (Server *) malloc(sizeof (Server));
+    if (this == NULL)
+    {
+        printf("Server: ::server_construct Memory allocation failed");
+        exit(1);
+    }
+    /* Set initial values for data members */
+    this->cls = SERVER;
+    this->ann = ann;
+    this->batch = batch < 1 ? 1 : batch;
+    this->delay = delay < 0 ? 0 : delay;
+    this->listen_fd = fd;
+    this->path = strncmp(address, "unix:", 5) == 0 ? strdup(address + 5) : NULL;
+    this->stop = 0;
+    this->head = 0;
+    this->depth = 0;
+    this->connection_count = 0;
+    this->closing = 0;
+    this->requests = 0;
+    this->passes = 0;
+    memset(this->depths, 0, sizeof (this->depths));
+    memset(this->latencies, 0, sizeof (this->latencies));
+    this->dispatcher = (void *) server_dispatcher; /* Add the dispatcher pointer */
+    pthread_mutex_init(&this->lock, NULL);
+    /* Batch deadlines are taken on the monotonic clock */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&this->waiting, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&this->space, NULL);
+    pthread_cond_init(&this->closed, NULL);
+    /* The queue, connections, histogram and batcher scratch in one arena */
+    bytes = arena_round(SERVER_QUEUE * sizeof (ServerRequest *))
+            + arena_round(SERVER_CONNECTIONS * sizeof (int))
+            + arena_round((this->batch + 1) * sizeof (long))
+            + arena_round(this->batch * sizeof (ServerRequest *))
+            + arena_round((size_t) this->batch * ann->input_count * sizeof (float))
+            + arena_round((size_t) this->batch * ann->output_count * sizeof (float));
+    arena_open(&this->arena, bytes);
+    this->queue = arena_take(&this->arena, SERVER_QUEUE * sizeof (ServerRequest *));
+    this->connections = arena_take(&this->arena, SERVER_CONNECTIONS * sizeof (int));
+    this->batch_sizes = arena_take(&this->arena, (this->batch + 1) * sizeof (long));
+    this->taken = arena_take(&this->arena, this->batch * sizeof (ServerRequest *));
+    this->inputs = arena_take(&this->arena, (size_t) this->batch * ann->input_count * sizeof (float));
+    this->outputs = arena_take(&this->arena, (size_t) this->batch * ann->output_count * sizeof (float));
+    this->ws = AnnWorkspace(ann, this->batch);
+    if (pthread_create(&this->batcher, NULL, server_batcher, this) != 0)
+    {
+        printf("Server: ::server_construct Thread creation failed");
+        exit(1);
+    }
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Turn the connections away, let the batcher finish what is queued and
+ * free the memory */
+static void server_destruct(Server *this)
+{
+    int i;
+
+    close(this->listen_fd);
+    if (this->path != NULL)
+    {
+        unlink(this->path);
+        free(this->path);
+    }
+    pthread_mutex_lock(&this->lock);
+    for (i = 0; i < this->connection_count; i++)
+    {
+        shutdown(this->connections[i], SHUT_RDWR);
+    }
+    while (this->connection_count > 0)
+    {
+        pthread_cond_wait(&this->closed, &this->lock);
+    }
+    this->closing = 1;
+    pthread_cond_signal(&this->waiting);
+    pthread_mutex_unlock(&this->lock);
+    pthread_join(this->batcher, NULL);
+    pthread_cond_destroy(&this->waiting);
+    pthread_cond_destroy(&this->space);
+    pthread_cond_destroy(&this->closed);
+    pthread_mutex_destroy(&this->lock);
+    WorkspaceDestroy(this->ws);
+    arena_close(&this->arena);
+    free(this);
+}
+
+/* Accept connections until server_stop, a thread for each */
+void server_run(Server *this)
+{
+    int fd, one = 1;
+    struct pollfd pfd;
+    pthread_t thread;
+    pthread_attr_t attr;
+    ServerConnection *connection;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pfd.fd = this->listen_fd;
+    pfd.events = POLLIN;
+    /* The timeout bounds how long a stop from a signal handler waits */
+    while (!this->stop)
+    {
+        if (poll(&pfd, 1, 200) <= 0)
+        {
+            continue;
+        }
+        fd = accept(this->listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+        /* Replies are small, send them at once */
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+        pthread_mutex_lock(&this->lock);
+        if (this->connection_count == SERVER_CONNECTIONS)
+        {
+            pthread_mutex_unlock(&this->lock);
+            close(fd);
+            continue;
+        }
+        this->connections[this->connection_count++] = fd;
+        pthread_mutex_unlock(&this->lock);
+        connection = malloc(sizeof (ServerConnection));
+        if (connection == NULL)
+        {
+            printf("Server: ::server_run Memory allocation failed");
+            exit(1);
+        }
+        connection->server = this;
+        connection->fd = fd;
+        if (pthread_create(&thread, &attr, server_connection, connection) != 0)
+        {
+            free(connection);
+            server_close(this, fd);
+        }
+    }
+    pthread_attr_destroy(&attr);
+}
+
+/* Ends server_run, safe in a signal handler */
+void server_stop(Server *this)
+{
+    this->stop = 1;
+}
+
+/* Counts and histograms as JSON */
+void server_json(Server *this, FILE *fp)
+{
+    pthread_mutex_lock(&this->lock);
+    fprintf(fp, "{\n  \"batch\": %d,\n  \"delay_us\": %ld,\n  \"connections\": %d,\n"
+            "  \"queued\": %d,\n  \"requests\": %ld,\n  \"passes\": %ld,\n",
+            this->batch, this->delay, this->connection_count, this->depth,
+            this->requests, this->passes);
+    fprintf(fp, "  \"mean_batch\": %.3f,\n", this->passes ? (double) this->requests / this->passes : 0.0);
+    server_histogram(fp, "batch_sizes", this->batch_sizes, this->batch + 1, 0);
+    server_histogram(fp, "queue_depths", this->depths, SERVER_BUCKETS, 0);
+    server_histogram(fp, "latency_us", this->latencies, SERVER_BUCKETS, 1);
+    fprintf(fp, "}\n");
+    pthread_mutex_unlock(&this->lock);
+}
+
+/* "name": [counts], trailing zero counts dropped */
+static void server_histogram(FILE *fp, const char *name, const long *counts, int n, int last)
+{
+    int i;
+
+    while (n > 1 && counts[n - 1] == 0)
+    {
+        n--;
+    }
+    fprintf(fp, "  \"%s\": [", name);
+    for (i = 0; i < n; i++)
+    {
+        fprintf(fp, "%s%ld", i ? ", " : "", counts[i]);
+    }
+    fprintf(fp, "]%s\n", last ? "" : ",");
+}
+
+/* Connected socket to a server at address, -1 on failure */
+int server_connect(const char *address)
+{
+    int fd, one = 1;
+
+    fd = server_socket(address, 0);
+    if (fd >= 0)
+    {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+    }
+    return (fd);
+}
+
+/* All of buf, 1 when sent */
+int server_send(int fd, const void *buf, size_t size)
+{
+    ssize_t n;
+    const char *p = buf;
+
+    while (size > 0)
+    {
+        n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return (0);
+        }
+        p += n;
+        size -= n;
+    }
+    return (1);
+}
+
+/* All of buf, 0 at the end of the stream or on an error */
+int server_receive(int fd, void *buf, size_t size)
+{
+    ssize_t n;
+    char *p = buf;
+
+    while (size > 0)
+    {
+        n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return (0);
+        }
+        p += n;
+        size -= n;
+    }
+    return (1);
+}
+
+/* Listening or connected socket for unix:path or [host:]port */
+static int server_socket(const char *address, int listening)
+{
+    int fd, one = 1;
+    char host[256];
+    const char *port;
+    struct sockaddr_un un;
+    struct addrinfo hints, *list, *ai;
+    struct stat st;
+
+    if (strncmp(address, "unix:", 5) == 0)
+    {
+        if (strlen(address + 5) >= sizeof (un.sun_path))
+        {
+            printf("Server: socket path %s is too long\n", address + 5);
+            return (-1);
+        }
+        memset(&un, 0, sizeof (un));
+        un.sun_family = AF_UNIX;
+        strcpy(un.sun_path, address + 5);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            printf("Server: Cannot create a socket for %s\n", address);
+            return (-1);
+        }
+        /* A socket left by an earlier server, never any other file */
+        if (listening && stat(un.sun_path, &st) == 0 && S_ISSOCK(st.st_mode))
+        {
+            unlink(un.sun_path);
+        }
+        if (listening ? bind(fd, (struct sockaddr *) &un, sizeof (un)) != 0 || listen(fd, 64) != 0
+                : connect(fd, (struct sockaddr *) &un, sizeof (un)) != 0)
+        {
+            printf("Server: Cannot %s %s\n", listening ? "listen on" : "connect to", address);
+            close(fd);
+            return (-1);
+        }
+        return (fd);
+    }
+    /* [host:]port, every interface or the loopback without a host */
+    port = strrchr(address, ':');
+    host[0] = '\0';
+    if (port != NULL)
+    {
+        snprintf(host, sizeof (host), "%.*s", (int) (port - address), address);
+        port++;
+    }
+    else
+    {
+        port = address;
+    }
+    memset(&hints, 0, sizeof (hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    if (getaddrinfo(host[0] ? host : NULL, port, &hints, &list) != 0)
+    {
+        printf("Server: Cannot resolve %s\n", address);
+        return (-1);
+    }
+    fd = -1;
+    for (ai = list; ai != NULL && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+        if (listening)
+        {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+        }
+        if (listening ? bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, 64) != 0
+                : connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(list);
+    if (fd < 0)
+    {
+        printf("Server: Cannot %s %s\n", listening ? "listen on" : "connect to", address);
+    }
+    return (fd);
+}
+
+/* Read requests from one client until it hangs up, queueing each sample
+ * and waiting for the batcher to fill in its outputs */
+static void * server_connection(void *arg)
+{
+    ServerConnection *connection = arg;
+    Server *this = connection->server;
+    int fd = connection->fd;
+    int32_t kind, length, shape[2];
+    int alive;
+    size_t size;
+    char *text;
+    FILE *fp;
+    float *input, *output;
+    ServerRequest request;
+
+    free(connection);
+    input = malloc(this->ann->input_count * sizeof (float));
+    output = malloc(this->ann->output_count * sizeof (float));
+    if (input == NULL || output == NULL)
+    {
+        printf("Server: ::server_connection Memory allocation failed");
+        exit(1);
+    }
+    request.input = input;
+    request.output = output;
+    pthread_cond_init(&request.ready, NULL);
+    shape[0] = this->ann->input_count;
+    shape[1] = this->ann->output_count;
+    alive = server_send(fd, shape, sizeof (shape));
+    while (alive && server_receive(fd, &kind, sizeof (kind)))
+    {
+        if (kind == SERVER_INFER)
+        {
+            if (!server_receive(fd, input, this->ann->input_count * sizeof (float)))
+            {
+                break;
+            }
+            request.done = 0;
+            request.arrived = server_now();
+            pthread_mutex_lock(&this->lock);
+            while (this->depth == SERVER_QUEUE)
+            {
+                pthread_cond_wait(&this->space, &this->lock);
+            }
+            this->queue[(this->head + this->depth) % SERVER_QUEUE] = &request;
+            this->depth++;
+            /* The batcher wants the first of a pass and the last it can get */
+            if (this->depth == 1 || this->depth == this->batch
+                || this->depth == this->connection_count)
+            {
+                pthread_cond_signal(&this->waiting);
+            }
+            while (!request.done)
+            {
+                pthread_cond_wait(&request.ready, &this->lock);
+            }
+            pthread_mutex_unlock(&this->lock);
+            if (!server_send(fd, output, this->ann->output_count * sizeof (float)))
+            {
+                break;
+            }
+        }
+        else if (kind == SERVER_STATS)
+        {
+            fp = open_memstream(&text, &size);
+            if (fp == NULL)
+            {
+                break;
+            }
+            server_json(this, fp);
+            fclose(fp);
+            length = (int32_t) size;
+            alive = server_send(fd, &length, sizeof (length)) && server_send(fd, text, size);
+            free(text);
+        }
+        else
+        {
+            break;
+        }
+    }
+    pthread_cond_destroy(&request.ready);
+    free(input);
+    free(output);
+    server_close(this, fd);
+    return (NULL);
+}
+
+/* Drop fd from the open connections and close it */
+static void server_close(Server *this, int fd)
+{
+    int i;
+
+    pthread_mutex_lock(&this->lock);
+    for (i = 0; i < this->connection_count; i++)
+    {
+        if (this->connections[i] == fd)
+        {
+            this->connections[i] = this->connections[--this->connection_count];
+            break;
+        }
+    }
+    close(fd);
+    pthread_cond_signal(&this->closed);
+    pthread_mutex_unlock(&this->lock);
+}
+
+/* Take batch requests, or as many as came within delay of the oldest,
+ * through one forward pass until closing with the queue empty */
+static void * server_batcher(void *arg)
+{
+    Server *this = arg;
+    int i, n, in = this->ann->input_count, out = this->ann->output_count;
+    uint64_t deadline, now;
+    struct timespec ts;
+    ServerRequest *request;
+
+    pthread_mutex_lock(&this->lock);
+    for (;;)
+    {
+        while (this->depth == 0 && !this->closing)
+        {
+            pthread_cond_wait(&this->waiting, &this->lock);
+        }
+        if (this->depth == 0)
+        {
+            break;
+        }
+        /* A connection has one request at most in flight, so once every
+         * connection is waiting the batch can only grow by a new one */
+        deadline = this->queue[this->head]->arrived + (uint64_t) this->delay * 1000;
+        while (this->depth < this->batch && this->depth < this->connection_count
+               && !this->closing && server_now() < deadline)
+        {
+            ts.tv_sec = deadline / 1000000000;
+            ts.tv_nsec = deadline % 1000000000;
+            pthread_cond_timedwait(&this->waiting, &this->lock, &ts);
+        }
+        this->depths[server_bucket(this->depth)]++;
+        n = this->depth < this->batch ? this->depth : this->batch;
+        for (i = 0; i < n; i++)
+        {
+            this->taken[i] = this->queue[this->head];
+            this->head = (this->head + 1) % SERVER_QUEUE;
+        }
+        this->depth -= n;
+        pthread_cond_broadcast(&this->space);
+        pthread_mutex_unlock(&this->lock);
+        /* The requests stay put while their connections wait */
+        for (i = 0; i < n; i++)
+        {
+            memcpy(this->inputs + (size_t) i * in, this->taken[i]->input, in * sizeof (float));
+        }
+        AnnInfer(this->ann, this->ws, this->inputs, n, this->outputs);
+        now = server_now();
+        pthread_mutex_lock(&this->lock);
+        for (i = 0; i < n; i++)
+        {
+            request = this->taken[i];
+            memcpy(request->output, this->outputs + (size_t) i * out, out * sizeof (float));
+            this->latencies[server_bucket((now - request->arrived) / 1000)]++;
+            request->done = 1;
+            pthread_cond_signal(&request->ready);
+        }
+        this->batch_sizes[n]++;
+        this->passes++;
+        this->requests += n;
+    }
+    pthread_mutex_unlock(&this->lock);
+    return (NULL);
+}
+
+/* Power of two bucket of value, 0 for 0 */
+static int server_bucket(uint64_t value)
+{
+    int bucket = 0;
+
+    while (value > 0 && bucket < SERVER_BUCKETS - 1)
+    {
+        value >>= 1;
+        bucket++;
+    }
+    return (bucket);
+}
+
+static uint64_t server_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+void server_dispatcher(Server *this, int mthd, int attr, void *msg)
+{
+    switch (mthd)
+    {
+    case(SERVER_DESTROY): server_destruct(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Server: ::server_dispatcher: Unknown method %d\n", mthd);
+    }
+}
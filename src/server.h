@@ -0,0 +1,119 @@
+/*
+ * File: server.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Local inference server. Clients connect over a Unix domain socket,
+ * address unix:path, or TCP, address [host:]port, and send one sample per
+ * request. A thread per connection reads the requests and queues them;
+ * one batcher thread takes up to batch of them at a time through a single
+ * ann_infer call, waiting no more than delay microseconds after the oldest
+ * arrived for the rest to fill, and hands each connection its outputs to
+ * write back. A connection has one request in flight at a time, so a pass
+ * also starts as soon as every open connection is waiting on one. A busy
+ * server runs full batches at GEMM throughput, a quiet one answers at once
+ * and none waits more than the delay for others.
+ *
+ * The protocol is in native byte order, clients are local:
+ *
+ *   on connect the server sends int32 input_count and output_count
+ *   SERVER_INFER   int32 kind, input_count floats; output_count floats back
+ *   SERVER_STATS   int32 kind; int32 length and that many bytes of JSON back
+ *
+ * The JSON (server_json) holds request and pass counts and histograms of
+ * the batch size of each pass, the queue depth as each pass starts and
+ * the microseconds from a request arriving to its outputs being ready.
+ * The depth and latency histograms have power of two buckets, bucket b
+ * counting values from 2^(b - 1) up to 2^b - 1 and bucket 0 zero.
+ *
+ * The network is only read, it must not be trained while it is served.
+ */
+#ifndef SERVER_H
+#define	SERVER_H
+
+#include <signal.h>
+#include <pthread.h>
+#include "ann.h"
+/* Class Id */
+#define SERVER              (('S'+'E'+'R'+'V'+'E'+'R') << 16)
+/* Methods */
+#define SERVER_DESTROY      SERVER + 1
+/* Request kinds */
+#define SERVER_INFER        1
+#define SERVER_STATS        2
+/* Defaults */
+#define SERVER_BATCH        32      /* Most requests per pass */
+#define SERVER_DELAY        1000    /* Microseconds the oldest request waits */
+/* Limits */
+#define SERVER_QUEUE        1024    /* Requests queued, readers wait beyond */
+#define SERVER_CONNECTIONS  256     /* Open at once, more are turned away */
+#define SERVER_BUCKETS      32      /* Of the depth and latency histograms */
+
+/* One queued sample, owned by the connection waiting on it */
+typedef struct
+{
+    const float *input;
+    float *output;
+    uint64_t arrived;   /* Monotonic nanoseconds */
+    int done;
+    pthread_cond_t ready;
+} ServerRequest;
+
+/* Forward declarations */
+typedef struct _Server Server;
+
+struct _Server
+{
+    int cls;
+    Ann *ann;           /* Borrowed */
+    int batch;
+    long delay;
+    int listen_fd;
+    char *path;         /* Unix socket to unlink, NULL for TCP */
+    volatile sig_atomic_t stop; /* Set by server_stop, ends server_run */
+    /* Everything below is under lock */
+    pthread_mutex_t lock;
+    pthread_cond_t waiting;     /* Requests queued, or closing */
+    pthread_cond_t space;       /* Room in the queue */
+    pthread_cond_t closed;      /* A connection ended */
+    ServerRequest **queue;      /* Ring of SERVER_QUEUE */
+    int head;
+    int depth;
+    int *connections;           /* Sockets of open connections */
+    int connection_count;
+    int closing;                /* The batcher drains the queue and exits */
+    /* Histograms */
+    long requests;
+    long passes;
+    long *batch_sizes;          /* batch + 1, passes of each size */
+    long depths[SERVER_BUCKETS];
+    long latencies[SERVER_BUCKETS];
+    /* Batcher, its scratch carved from arena */
+    pthread_t batcher;
+    Workspace *ws;
+    ServerRequest **taken;      /* batch, the requests of a pass */
+    float *inputs;              /* batch x input_count */
+    float *outputs;             /* batch x output_count */
+    Arena arena;
+    void (*dispatcher)(Server * this, int mthd, int attr, void * msg);
+};
+
+/* Prototypes */
+Server * server_construct(Ann * ann, const char *address, int batch, long delay);
+void server_dispatcher(Server * this, int mthd, int attr, void * msg);
+void server_run(Server * this);
+void server_stop(Server * this);
+void server_json(Server * this, FILE * fp);
+int server_connect(const char *address);
+int server_send(int fd, const void *buf, size_t size);
+int server_receive(int fd, void *buf, size_t size);
+/* Macros */
+#define ServerNew(ann, address, batch, delay)   ((server_construct)(ann, address, batch, delay))
+#define ServerDestroy(this)                 ((this->dispatcher)(this, SERVER_DESTROY, 0, NULL))
+#define ServerRun(this)                     ((server_run)(this))
+#define ServerStop(this)                    ((server_stop)(this))
+#define ServerJson(this, fp)                ((server_json)(this, fp))
+
+#endif	/* SERVER_H */
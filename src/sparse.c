@@ -0,0 +1,305 @@
+/*
+ * File: sparse.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include "sparse.h"
+#include "kernel.h"
+
+/* Prototypes */
+static long sparse_prune_layer(Layer *layer, float share, float *scratch, float *square);
+static int sparse_compare(const void *a, const void *b);
+static void sparse_destruct(Sparse *this);
+static int sparse_nonzero(const Layer *layer);
+static size_t sparse_layer_bytes(const Layer *layer, int nonzero, float density);
+static void sparse_layer(SparseLayer *s, Arena *arena, const Layer *layer, int nonzero, float density);
+static void sparse_forward_layer(const SparseLayer *s, const float *in, int ldin, int rows,
+                                 float *out, int ldout);
+
+/* Zero share (0 to 1) of the smallest weights of each layer of ann,
+ * returns the number pruned */
+long sparse_prune(Ann *ann, float share)
+{
+    int i, widest = 1;
+    long zeroed = 0;
+    float *scratch;
+
+    share = share < 0 ? 0 : share > 1 ? 1 : share;
+    for (i = 0; i < ann->layer_count; i++)
+    {
+        widest = ann->layers[i]->count * ann->layers[i]->inputCnt > widest
+                ? ann->layers[i]->count * ann->layers[i]->inputCnt : widest;
+    }
+    scratch = malloc((size_t) widest * sizeof (float));
+    if (scratch == NULL)
+    {
+        printf("Sparse: ::sparse_prune Memory allocation failed");
+        exit(1);
+    }
+    for (i = 0; i < ann->layer_count; i++)
+    {
+        zeroed += sparse_prune_layer(ann->layers[i], share, scratch,
+                                     ann->optim.square != NULL ? ann->optim.square[i] : NULL);
+    }
+    free(scratch);
+    return (zeroed);
+}
+
+/* The cut is the magnitude of the last weight to go, ties at it are taken
+ * in row order until the share is reached. square is the second moment of
+ * the optimiser for layer, NULL when it keeps none. */
+static long sparse_prune_layer(Layer *layer, float share, float *scratch, float *square)
+{
+    int i, j;
+    long n = 0, k, zeroed = 0;
+    float cut, *row, *change;
+
+    for (j = 0; j < layer->count; j++)
+    {
+        row = LayerRow(layer, weights, j);
+        for (i = 0; i < layer->inputCnt; i++)
+        {
+            scratch[n++] = fabsf(row[i]);
+        }
+    }
+    k = (long) (share * n);
+    if (k == 0)
+    {
+        return (0);
+    }
+    qsort(scratch, n, sizeof (float), sparse_compare);
+    cut = scratch[k - 1];
+    /* Everything under the cut first, then ties */
+    for (j = 0; j < layer->count; j++)
+    {
+        row = LayerRow(layer, weights, j);
+        change = LayerRow(layer, wchange, j);
+        for (i = 0; i < layer->inputCnt; i++)
+        {
+            if (fabsf(row[i]) < cut)
+            {
+                row[i] = 0;
+                change[i] = 0;
+                if (square != NULL)
+                {
+                    square[(size_t) j * layer->stride + i] = 0;
+                }
+                zeroed++;
+            }
+        }
+    }
+    for (j = 0; j < layer->count && zeroed < k; j++)
+    {
+        row = LayerRow(layer, weights, j);
+        change = LayerRow(layer, wchange, j);
+        for (i = 0; i < layer->inputCnt && zeroed < k; i++)
+        {
+            if (fabsf(row[i]) == cut)
+            {
+                row[i] = 0;
+                change[i] = 0;
+                if (square != NULL)
+                {
+                    square[(size_t) j * layer->stride + i] = 0;
+                }
+                zeroed++;
+            }
+        }
+    }
+    return (zeroed);
+}
+
+static int sparse_compare(const void *a, const void *b)
+{
+    float x = *(const float *) a, y = *(const float *) b;
+
+    return ((x > y) - (x < y));
+}
+
+/* Instantiate an inference copy of ann, layers with fewer than density of
+ * their weights nonzero held sparse. The network itself is not changed. */
+Sparse * sparse_construct(const Ann *ann, float density)
+{
+    int i, *nonzero;
+    size_t bytes;
+    Sparse *this = NULL;
+    /* Allocate memory */
+    this = (Sparse *) malloc(sizeof (Sparse));
+    nonzero = malloc(ann->layer_count * sizeof (int));
+    if (this == NULL || nonzero == NULL)
+    {
+        printf("Sparse: ::sparse_construct Memory allocation failed");
+        exit(1);
+    }
+    /* Set initial values for data members */
+    this->cls = SPARSE;
+    this->input_count = ann->input_count;
+    this->output_count = ann->output_count;
+    this->layer_count = ann->layer_count;
+    this->dispatcher = (void *) sparse_dispatcher; /* Add the dispatcher pointer */
+    /* One arena for the parameters and the scratch */
+    this->bytes = 0;
+    this->pitch = 1;
+    for (i = 0; i < ann->layer_count; i++)
+    {
+        nonzero[i] = sparse_nonzero(ann->layers[i]);
+        this->bytes += sparse_layer_bytes(ann->layers[i], nonzero[i], density);
+        this->pitch = ann->layers[i]->count > this->pitch ? ann->layers[i]->count : this->pitch;
+    }
+    this->pitch = arena_round(this->pitch * sizeof (float)) / sizeof (float);
+    bytes = arena_round(ann->layer_count * sizeof (SparseLayer)) + this->bytes
+            + 2 * arena_round((size_t) SPARSE_ROWS * this->pitch * sizeof (float));
+    arena_open(&this->arena, bytes);
+    this->layers = arena_take(&this->arena, ann->layer_count * sizeof (SparseLayer));
+    for (i = 0; i < ann->layer_count; i++)
+    {
+        sparse_layer(&this->layers[i], &this->arena, ann->layers[i], nonzero[i], density);
+    }
+    this->act[0] = arena_take(&this->arena, (size_t) SPARSE_ROWS * this->pitch * sizeof (float));
+    this->act[1] = arena_take(&this->arena, (size_t) SPARSE_ROWS * this->pitch * sizeof (float));
+    free(nonzero);
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Do any clean up needed and free the memory */
+static void sparse_destruct(Sparse *this)
+{
+    arena_close(&this->arena);
+    free(this);
+}
+
+static int sparse_nonzero(const Layer *layer)
+{
+    int i, j, nonzero = 0;
+    const float *row;
+
+    for (j = 0; j < layer->count; j++)
+    {
+        row = LayerRow(layer, weights, j);
+        for (i = 0; i < layer->inputCnt; i++)
+        {
+            nonzero += row[i] != 0;
+        }
+    }
+    return (nonzero);
+}
+
+/* Arena room for one layer in the form its density picks */
+static size_t sparse_layer_bytes(const Layer *layer, int nonzero, float density)
+{
+    size_t bytes = arena_round(layer->count * sizeof (float));
+
+    if (nonzero < density * layer->count * layer->inputCnt)
+    {
+        return (bytes + arena_round((layer->count + 1) * sizeof (int32_t))
+                + arena_round((size_t) nonzero * sizeof (int32_t))
+                + arena_round((size_t) nonzero * sizeof (float)));
+    }
+    return (bytes + arena_round((size_t) layer->count * layer->stride * sizeof (float)));
+}
+
+/* Copy layer into s, packing the nonzero weights when sparse enough */
+static void sparse_layer(SparseLayer *s, Arena *arena, const Layer *layer, int nonzero, float density)
+{
+    int i, j, k = 0;
+    const float *row;
+
+    s->count = layer->count;
+    s->inputCnt = layer->inputCnt;
+    s->activation = layer->activation;
+    s->slope = layer->slope;
+    s->nonzero = nonzero;
+    s->threshold = arena_take(arena, s->count * sizeof (float));
+    memcpy(s->threshold, layer->threshold, s->count * sizeof (float));
+    if (nonzero >= density * layer->count * layer->inputCnt)
+    {
+        s->stride = layer->stride;
+        s->weights = arena_take(arena, (size_t) s->count * s->stride * sizeof (float));
+        memcpy(s->weights, layer->weights, (size_t) s->count * s->stride * sizeof (float));
+        s->start = NULL;
+        s->columns = NULL;
+        s->values = NULL;
+        return;
+    }
+    s->stride = 0;
+    s->weights = NULL;
+    s->start = arena_take(arena, (s->count + 1) * sizeof (int32_t));
+    s->columns = arena_take(arena, (size_t) nonzero * sizeof (int32_t));
+    s->values = arena_take(arena, (size_t) nonzero * sizeof (float));
+    for (j = 0; j < s->count; j++)
+    {
+        s->start[j] = k;
+        row = LayerRow(layer, weights, j);
+        for (i = 0; i < s->inputCnt; i++)
+        {
+            if (row[i] != 0)
+            {
+                s->columns[k] = i;
+                s->values[k++] = row[i];
+            }
+        }
+    }
+    s->start[s->count] = k;
+}
+
+/* Evaluate rows input vectors, inputs is rows x input_count and outputs
+ * rows x output_count, as ann_forward_batch does for the full network */
+void sparse_forward(Sparse *this, const float *inputs, int rows, float *outputs)
+{
+    int r, n, l, ldin, last = this->layer_count - 1;
+    const float *in;
+
+    for (r = 0; r < rows; r += n)
+    {
+        n = rows - r < SPARSE_ROWS ? rows - r : SPARSE_ROWS;
+        in = inputs + (size_t) r * this->input_count;
+        ldin = this->input_count;
+        for (l = 0; l < last; l++)
+        {
+            sparse_forward_layer(&this->layers[l], in, ldin, n, this->act[l & 1], this->pitch);
+            in = this->act[l & 1];
+            ldin = this->pitch;
+        }
+        sparse_forward_layer(&this->layers[last], in, ldin, n,
+                             outputs + (size_t) r * this->output_count, this->output_count);
+    }
+}
+
+static void sparse_forward_layer(const SparseLayer *s, const float *in, int ldin, int rows,
+                                 float *out, int ldout)
+{
+    int r, j;
+    float (*dot_sparse)(const float *, const int32_t *, int, const float *) = kernel_ops->dot_sparse;
+
+    if (s->weights != NULL)
+    {
+        kernel_gemm_nt(rows, s->count, s->inputCnt, in, ldin, s->weights, s->stride, out, ldout);
+    }
+    else
+    {
+        for (r = 0; r < rows; r++)
+        {
+            for (j = 0; j < s->count; j++)
+            {
+                out[(size_t) r * ldout + j] = dot_sparse(s->values + s->start[j], s->columns + s->start[j],
+                                                         s->start[j + 1] - s->start[j],
+                                                         in + (size_t) r * ldin);
+            }
+        }
+    }
+    kernel_bias_activation(out, rows, s->count, ldout, s->threshold, s->slope, s->activation);
+}
+
+void sparse_dispatcher(Sparse *this, int mthd, int attr, void *msg)
+{
+    switch (mthd)
+    {
+    case(SPARSE_DESTROY): sparse_destruct(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Sparse: ::sparse_dispatcher: Unknown method %d\n", mthd);
+    }
+}
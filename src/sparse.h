@@ -0,0 +1,91 @@
+/*
+ * File: sparse.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Magnitude pruning and sparse inference. AnnPrune zeroes the given share
+ * of the smallest weights of every layer of a trained network in place,
+ * along with their momentum and the second moment RMSProp or Adam keeps
+ * for them, so the pruned network can be saved, scored or trained on.
+ * Training lets the zeroed weights grow back; prune again before
+ * compiling.
+ *
+ * SparseNew compiles a network for inference the way QuantNew does. A
+ * layer whose share of nonzero weights is under the density given is held
+ * in compressed sparse row form, the nonzero weights of each neuron packed
+ * with their input columns and scored by the dot_sparse kernel, which
+ * gathers just those inputs. Denser layers stay dense matrices scored by
+ * kernel_gemm_nt as ann_forward_batch does, where a gather per weight
+ * would cost more than the multiplies by zero it saves.
+ *
+ * The choice is made here and only here. A pruned Ann scored through
+ * AnnForwardBatch, AnnInfer or AnnPredict still runs every layer dense,
+ * as those paths also serve a network that is training and whose zeroed
+ * weights grow back. Score a pruned network for speed through SparseNew.
+ */
+#ifndef SPARSE_H
+#define	SPARSE_H
+
+#include <stdint.h>
+#include "ann.h"
+/* Class Id */
+#define SPARSE              (('S'+'P'+'A'+'R'+'S'+'E') << 16)
+/* Methods */
+#define SPARSE_DESTROY      SPARSE + 1
+/* Share of nonzero weights under which a layer is held sparse */
+#define SPARSE_DENSITY      0.25f
+/* Rows scored per pass through the layers */
+#define SPARSE_ROWS         64
+
+/* One layer, sparse when weights is NULL */
+typedef struct
+{
+    int count;
+    int inputCnt;
+    int activation;
+    float slope;
+    int nonzero;        /* Weights kept */
+    /* Dense form */
+    int stride;         /* Row pitch in elements */
+    float *weights;     /* count x stride */
+    /* Compressed sparse rows, row j at start[j] up to start[j + 1] */
+    int32_t *start;     /* count + 1 */
+    int32_t *columns;   /* nonzero */
+    float *values;      /* nonzero */
+    float *threshold;   /* count */
+} SparseLayer;
+
+/* Forward declarations */
+typedef struct _Sparse Sparse;
+
+struct _Sparse
+{
+    int cls;
+    int input_count;
+    int output_count;
+    int layer_count;
+    SparseLayer *layers;
+    size_t bytes;       /* Parameter memory of all layers */
+    /* Scratch for SPARSE_ROWS samples, the object is not shared between
+     * threads */
+    int pitch;
+    float *act[2];      /* Activations, alternate layers */
+    Arena arena;
+    void (*dispatcher)(Sparse * this, int mthd, int attr, void * msg);
+};
+
+/* Prototypes */
+long sparse_prune(Ann * ann, float share);
+Sparse * sparse_construct(const Ann * ann, float density);
+void sparse_dispatcher(Sparse * this, int mthd, int attr, void * msg);
+void sparse_forward(Sparse * this, const float *inputs, int rows, float *outputs);
+/* Macros */
+#define AnnPrune(ann, share)                ((sparse_prune)(ann, share))
+#define SparseNew(ann)                      ((sparse_construct)(ann, SPARSE_DENSITY))
+#define SparseNewDensity(ann, density)      ((sparse_construct)(ann, density))
+#define SparseDestroy(this)                 ((this->dispatcher)(this, SPARSE_DESTROY, 0, NULL))
+#define SparseForward(this, inputs, rows, outputs) ((sparse_forward)(this, inputs, rows, outputs))
+
+#endif	/* SPARSE_H */
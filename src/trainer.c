@@ -0,0 +1,213 @@
+/*
+ * File: trainer.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ */
+#include <math.h>
+#include "trainer.h"
+#include "model.h"
+
+/* Prototypes */
+static void trainer_destruct(Trainer *this);
+static void trainer_keep(Trainer *this);
+static void trainer_restore(Trainer *this);
+
+/* Instantiate a trainer of ann on data for up to max_epochs, neither is
+ * owned */
+Trainer * trainer_construct(Ann *ann, Dataset *data, int max_epochs)
+{
+    int i;
+    size_t bytes;
+    Layer *layer;
+    Trainer *this = NULL;
+    /* Allocate memory */
+    this = (Trainer *) malloc(sizeof (Trainer));
+    if (this == NULL)
+    {
+        printf("Trainer: ::trainer_construct Memory allocation failed");
+        exit(1);
+    }
+    /* Set initial values for data members */
+    this->cls = TRAINER;
+    this->ann = ann;
+    this->data = data;
+    this->max_epochs = max_epochs;
+    this->patience = TRAINER_PATIENCE;
+    this->min_delta = TRAINER_MIN_DELTA;
+    this->checkpoint = NULL;
+    this->verbose = 1;
+    this->epoch = 0;
+    this->best_epoch = 0;
+    this->train_error = 0;
+    this->valid_error = -1;
+    this->best_error = 0;
+    this->stale = 0;
+    this->dispatcher = (void *) trainer_dispatcher; /* Add the dispatcher pointer */
+    /* Room for one copy of the parameters */
+    bytes = 2 * arena_round(ann->layer_count * sizeof (float *))
+            + arena_round(TRAINER_BLOCK * ann->output_count * sizeof (float));
+    for (i = 0; i < ann->layer_count; i++)
+    {
+        layer = ann->layers[i];
+        bytes += arena_round((size_t) layer->count * layer->stride * sizeof (float))
+                + arena_round(layer->count * sizeof (float));
+    }
+    arena_open(&this->arena, bytes);
+    this->weights = arena_take(&this->arena, ann->layer_count * sizeof (float *));
+    this->threshold = arena_take(&this->arena, ann->layer_count * sizeof (float *));
+    for (i = 0; i < ann->layer_count; i++)
+    {
+        layer = ann->layers[i];
+        this->weights[i] = arena_take(&this->arena, (size_t) layer->count * layer->stride * sizeof (float));
+        this->threshold[i] = arena_take(&this->arena, layer->count * sizeof (float));
+    }
+    this->outputs = arena_take(&this->arena, TRAINER_BLOCK * ann->output_count * sizeof (float));
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Do any clean up needed and free the memory */
+static void trainer_destruct(Trainer *this)
+{
+    arena_close(&this->arena);
+    free(this);
+}
+
+/* Train until max_epochs or a plateau, returns the epoch whose parameters
+ * the network is left with, 0 when there is no split to judge by */
+int trainer_run(Trainer *this)
+{
+    int rows;
+    long count;
+    const float *inputs, *targets;
+
+    while (this->epoch < this->max_epochs)
+    {
+        count = 0;
+        while ((rows = DatasetNext(this->data, &inputs, &targets)) > 0)
+        {
+            AnnTrain(this->ann, inputs, targets, rows);
+            count += rows;
+        }
+        this->epoch++;
+        this->train_error = AnnEpoch(this->ann);
+        if (count == 0)
+        {
+            printf("Trainer: ::trainer_run No training rows\n");
+            break;
+        }
+        this->valid_error = trainer_validate(this);
+        if (this->verbose)
+        {
+            printf("Epoch %d: %ld samples, RMS error %f", this->epoch, count, this->train_error);
+            if (this->valid_error >= 0)
+            {
+                printf(", validation %f", this->valid_error);
+            }
+            printf("\n");
+        }
+        if (this->valid_error < 0)
+        {
+            continue;
+        }
+        if (this->best_epoch == 0 || this->valid_error < this->best_error - this->min_delta)
+        {
+            this->best_epoch = this->epoch;
+            this->best_error = this->valid_error;
+            this->stale = 0;
+            trainer_keep(this);
+        }
+        else if (this->patience > 0 && ++this->stale >= this->patience)
+        {
+            if (this->verbose)
+            {
+                printf("No improvement in %d epochs, stopping\n", this->stale);
+            }
+            break;
+        }
+    }
+    /* Back to the best epoch */
+    if (this->best_epoch > 0 && this->best_epoch != this->epoch)
+    {
+        trainer_restore(this);
+        if (this->verbose)
+        {
+            printf("Best epoch %d, validation %f\n", this->best_epoch, this->best_error);
+        }
+    }
+    return (this->best_epoch);
+}
+
+/* RMS error of the network over the held out split, -1 if there is none.
+ * The split comes from the data set a chunk at a time. */
+float trainer_validate(Trainer *this)
+{
+    int n, rows, r;
+    int64_t total = 0;
+    long i, width = this->ann->output_count;
+    double sum = 0;
+    const float *inputs, *targets;
+
+    while ((rows = DatasetValidation(this->data, &inputs, &targets)) > 0)
+    {
+        for (r = 0; r < rows; r += n)
+        {
+            n = rows - r < TRAINER_BLOCK ? rows - r : TRAINER_BLOCK;
+            AnnForwardBatch(this->ann, inputs + (size_t) r * this->ann->input_count, n, this->outputs);
+            for (i = 0; i < n * width; i++)
+            {
+                sum += (targets[r * width + i] - this->outputs[i]) * (targets[r * width + i] - this->outputs[i]);
+            }
+        }
+        total += rows;
+    }
+    if (total == 0)
+    {
+        return (-1);
+    }
+    return (sqrt(sum / total));
+}
+
+/* Copy the parameters aside, and to the checkpoint file if there is one */
+static void trainer_keep(Trainer *this)
+{
+    int i;
+    Layer *layer;
+
+    for (i = 0; i < this->ann->layer_count; i++)
+    {
+        layer = this->ann->layers[i];
+        memcpy(this->weights[i], layer->weights, (size_t) layer->count * layer->stride * sizeof (float));
+        memcpy(this->threshold[i], layer->threshold, layer->count * sizeof (float));
+    }
+    if (this->checkpoint != NULL)
+    {
+        AnnSave(this->ann, this->checkpoint);
+    }
+}
+
+static void trainer_restore(Trainer *this)
+{
+    int i;
+    Layer *layer;
+
+    for (i = 0; i < this->ann->layer_count; i++)
+    {
+        layer = this->ann->layers[i];
+        memcpy(layer->weights, this->weights[i], (size_t) layer->count * layer->stride * sizeof (float));
+        memcpy(layer->threshold, this->threshold[i], layer->count * sizeof (float));
+    }
+}
+
+void trainer_dispatcher(Trainer *this, int mthd, int attr, void *msg)
+{
+    switch (mthd)
+    {
+    case(TRAINER_DESTROY): trainer_destruct(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Trainer: ::trainer_dispatcher: Unknown method %d\n", mthd);
+    }
+}
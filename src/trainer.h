@@ -0,0 +1,73 @@
+/*
+ * File: trainer.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 18, 2026
+ *
+ * Epochs over a data set with early stopping. Each epoch streams the
+ * training rows through ann_train, then scores the split held out of the
+ * data set (DatasetNewSplit) with ann_forward_batch. The parameters of the
+ * epoch with the lowest validation RMS error are copied aside, and saved
+ * to checkpoint when one is named. Once patience epochs go by without the
+ * error falling more than min_delta below the best, training stops; the
+ * network is left holding the best parameters either way.
+ *
+ * A data set with no split gives nothing to judge by, every epoch runs
+ * and the network keeps its last parameters.
+ */
+#ifndef TRAINER_H
+#define	TRAINER_H
+
+#include "ann.h"
+#include "dataset.h"
+/* Class Id */
+#define TRAINER             (('T'+'R'+'A'+'I'+'N'+'E'+'R') << 16)
+/* Methods */
+#define TRAINER_DESTROY     TRAINER + 1
+/* Defaults */
+#define TRAINER_PATIENCE    5
+#define TRAINER_MIN_DELTA   1e-4f
+/* Validation rows scored per ann_forward_batch call */
+#define TRAINER_BLOCK       256
+
+/* Forward declarations */
+typedef struct _Trainer Trainer;
+
+struct _Trainer
+{
+    int cls;
+    Ann *ann;           /* Borrowed */
+    Dataset *data;      /* Borrowed */
+    int max_epochs;
+    int patience;       /* Epochs without improvement before stopping, 0 never */
+    float min_delta;    /* Smallest fall in error that counts */
+    const char *checkpoint; /* Model file for the best parameters, NULL for none */
+    int verbose;        /* Print a line per epoch */
+    /* Progress */
+    int epoch;          /* Epochs run */
+    int best_epoch;     /* 0 until an epoch has been scored */
+    float train_error;  /* RMS error over the last epoch */
+    float valid_error;  /* On the split after it, -1 without one */
+    float best_error;
+    int stale;          /* Epochs since the best */
+    /* Parameters of the best epoch and validation scratch, one arena */
+    float **weights;    /* count x stride per layer */
+    float **threshold;  /* count per layer */
+    float *outputs;     /* TRAINER_BLOCK x output_count */
+    Arena arena;
+    void (*dispatcher)(Trainer * this, int mthd, int attr, void * msg);
+};
+
+/* Prototypes */
+Trainer * trainer_construct(Ann * ann, Dataset * data, int max_epochs);
+void trainer_dispatcher(Trainer * this, int mthd, int attr, void * msg);
+int trainer_run(Trainer * this);
+float trainer_validate(Trainer * this);
+/* Macros */
+#define TrainerNew(ann, data, max_epochs)   ((trainer_construct)(ann, data, max_epochs))
+#define TrainerDestroy(this)                ((this->dispatcher)(this, TRAINER_DESTROY, 0, NULL))
+#define TrainerRun(this)                    ((trainer_run)(this))
+#define TrainerValidate(this)               ((trainer_validate)(this))
+
+#endif	/* TRAINER_H */
@@ -0,0 +1,128 @@
+/*
+ * File: workspace.c
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ */
+#include "workspace.h"
+
+/* Prototypes */
+static void workspace_destruct(Workspace *this);
+static int workspace_pitch(const LayerSpec *spec, int layer_count);
+
+/* Instantiate a new object in an arena of its own */
+Workspace * workspace_construct(const LayerSpec *spec, int layer_count, int rows, int gradients)
+{
+    Arena arena;
+    Workspace *this;
+
+    arena_open(&arena, workspace_bytes(spec, layer_count, rows, gradients));
+    this = workspace_carve(&arena, spec, layer_count, rows, gradients);
+    this->arena = arena;
+    this->stateFlag |= WORKSPACE_ARENA;
+    return (this);
+}
+
+/* Arena room workspace_carve takes for rows samples of the layers in spec */
+size_t workspace_bytes(const LayerSpec *spec, int layer_count, int rows, int gradients)
+{
+    int i;
+    size_t table = arena_round(layer_count * sizeof (float *));
+    size_t bytes;
+
+    rows = rows > 0 ? rows : 1;
+    bytes = arena_round(sizeof (Workspace)) + 2 * table
+            + 2 * layer_count * arena_round((size_t) rows * workspace_pitch(spec, layer_count) * sizeof (float));
+    if (gradients)
+    {
+        bytes += 2 * table;
+        for (i = 0; i < layer_count; i++)
+        {
+            bytes += arena_round((size_t) spec[i].count * layer_stride(&spec[i]) * sizeof (float))
+                    + arena_round(spec[i].count * sizeof (float));
+        }
+    }
+    return (bytes);
+}
+
+/* Build a workspace from pieces of arena, which must have workspace_bytes
+ * left. At least one row. */
+Workspace * workspace_carve(Arena *arena, const LayerSpec *spec, int layer_count, int rows,
+                            int gradients)
+{
+    int i;
+    size_t size;
+    Workspace *this = NULL;
+
+    this = arena_take(arena, sizeof (Workspace));
+    /* Set initial values for data members */
+    this->cls = WORKSPACE;
+    this->layer_count = layer_count;
+    this->stateFlag = 0;
+    this->rows = rows > 0 ? rows : 1;
+    this->net_error = 0;
+    this->dispatcher = (void *) workspace_dispatcher; /* Add the dispatcher pointer */
+    /* Activations of every layer share one pitch so any can feed the next */
+    this->pitch = workspace_pitch(spec, layer_count);
+    this->act = arena_take(arena, layer_count * sizeof (float *));
+    this->delta = arena_take(arena, layer_count * sizeof (float *));
+    size = (size_t) this->rows * this->pitch * sizeof (float);
+    for (i = 0; i < layer_count; i++)
+    {
+        this->act[i] = arena_take(arena, size);
+        this->delta[i] = arena_take(arena, size);
+    }
+    this->grad = NULL;
+    this->tgrad = NULL;
+    if (gradients)
+    {
+        /* Padding columns of a gradient are never written, the arena
+         * starts zeroed */
+        this->grad = arena_take(arena, layer_count * sizeof (float *));
+        this->tgrad = arena_take(arena, layer_count * sizeof (float *));
+        for (i = 0; i < layer_count; i++)
+        {
+            this->grad[i] = arena_take(arena, (size_t) spec[i].count * layer_stride(&spec[i]) * sizeof (float));
+            this->tgrad[i] = arena_take(arena, spec[i].count * sizeof (float));
+        }
+    }
+    /* Return a pointer to the new object */
+    return (this);
+}
+
+/* Do any clean up needed and free the memory */
+static void workspace_destruct(Workspace *this)
+{
+    Arena arena;
+
+    if (this->stateFlag & WORKSPACE_ARENA)
+    {
+        /* The arena holds this Workspace too, copy it out first */
+        arena = this->arena;
+        arena_close(&arena);
+    }
+}
+
+/* Widest layer rounded up to a whole number of cache lines */
+static int workspace_pitch(const LayerSpec *spec, int layer_count)
+{
+    int i, widest = 1;
+
+    for (i = 0; i < layer_count; i++)
+    {
+        widest = spec[i].count > widest ? spec[i].count : widest;
+    }
+    return ((widest + 15) & ~15);
+}
+
+void workspace_dispatcher(Workspace *this, int mthd, int attr, void *msg)
+{
+    switch (mthd)
+    {
+    case(WORKSPACE_DESTROY): workspace_destruct(this);
+        break;
+        /* If this is a base class print an error message or set an error flag */
+    default: printf("Workspace: ::workspace_dispatcher: Unknown method %d\n", mthd);
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * File: workspace.h
+ * Program:
+ * Author: Richard G Townsend
+ * Email: ricktee@virginmedia.com
+ * Created on: October 17, 2026
+ *
+ * Scratch for the batched passes over a stack of layers: activations and
+ * errors for a number of sample rows and, when training, a private copy of
+ * the weight and threshold gradients. Each training thread owns one so
+ * shards of a batch never write to shared memory.
+ *
+ * A workspace holds a fixed number of rows, callers with more work through
+ * them that many at a time. It is carved from an arena, one of its own or
+ * that of its owner, and never allocates after it is built.
+ */
+#ifndef WORKSPACE_H
+#define	WORKSPACE_H
+
+#include "layer.h"
+/* Class Id */
+#define WORKSPACE           (('W'+'O'+'R'+'K'+'S'+'P'+'A'+'C'+'E') << 16)
+/* Methods */
+#define WORKSPACE_DESTROY   WORKSPACE + 1
+/* State flags */
+#define WORKSPACE_ARENA     0x01    /* Owns the arena it was carved from */
+
+/* Forward declarations */
+typedef struct _Workspace Workspace;
+
+struct _Workspace
+{
+    int cls;
+    int layer_count;
+    int stateFlag;
+    int rows;           /* Sample rows the matrices hold */
+    int pitch;          /* Row pitch of the activation and error matrices */
+    float **act;        /* rows x pitch per layer */
+    float **delta;      /* rows x pitch per layer */
+    float **grad;       /* count x stride per layer, NULL unless training */
+    float **tgrad;      /* count per layer, NULL unless training */
+    float net_error;    /* Summed squared output error of the last pass */
+    Arena arena;        /* Closed unless WORKSPACE_ARENA */
+    void (*dispatcher)(Workspace * this, int mthd, int attr, void * msg);
+};
+
+/* Prototypes */
+Workspace * workspace_construct(const LayerSpec * spec, int layer_count, int rows, int gradients);
+Workspace * workspace_carve(Arena * arena, const LayerSpec * spec, int layer_count, int rows,
+                            int gradients);
+size_t workspace_bytes(const LayerSpec * spec, int layer_count, int rows, int gradients);
+void workspace_dispatcher(Workspace * this, int mthd, int attr, void * msg);
+/* Macros */
+#define WorkspaceNew(spec, layer_count, rows, gradients) ((workspace_construct)(spec, layer_count, rows, gradients))
+#define WorkspaceDestroy(this)              ((this->dispatcher)(this, WORKSPACE_DESTROY, 0, NULL))
+
+#endif	/* WORKSPACE_H */